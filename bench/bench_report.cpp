@@ -0,0 +1,126 @@
+#include "bench_report.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <numeric>
+#include <utility>
+
+namespace sde {
+
+	static double percentile(const std::vector<double>& sorted, double p)
+	{
+		if (sorted.empty()) return 0.0;
+
+		// Linear interpolation between the two closest ranks
+		double rank = p * static_cast<double>(sorted.size() - 1);
+		size_t lower = static_cast<size_t>(std::floor(rank));
+		size_t upper = std::min(lower + 1, sorted.size() - 1);
+		double fraction = rank - static_cast<double>(lower);
+
+		return sorted[lower] + (sorted[upper] - sorted[lower]) * fraction;
+	}
+
+	BenchStats BenchStats::compute(std::vector<double> samples)
+	{
+		BenchStats stats;
+		if (samples.empty()) return stats;
+
+		std::sort(samples.begin(), samples.end());
+
+		stats.count = samples.size();
+		stats.min = samples.front();
+		stats.max = samples.back();
+		stats.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / static_cast<double>(samples.size());
+		stats.p50 = percentile(samples, 0.50);
+		stats.p95 = percentile(samples, 0.95);
+		stats.p99 = percentile(samples, 0.99);
+
+		return stats;
+	}
+
+	static std::vector<std::pair<const char*, BenchStats>> collectStats(const BenchReport& report)
+	{
+		return {
+			{ "frame", BenchStats::compute(report.frameMs) },
+			{ "begin_frame", BenchStats::compute(report.beginFrameMs) },
+			{ "record", BenchStats::compute(report.recordMs) },
+			{ "end_frame", BenchStats::compute(report.endFrameMs) },
+			{ "cull", BenchStats::compute(report.cullMs) },
+			{ "gpu_frame", BenchStats::compute(report.gpuFrameMs) },
+		};
+	}
+
+	void BenchReport::writeCsv(std::ostream& out) const
+	{
+		out << std::fixed << std::setprecision(4);
+		out << "scene,objects,frames,width,height,gpu_culling,metric,count,min_ms,mean_ms,p50_ms,p95_ms,p99_ms,max_ms\n";
+
+		auto prefix = [&]() -> std::ostream& {
+			return out << scene << ',' << objectCount << ',' << frameCount << ',' << width << ',' << height << ',' << gpuCulling << ',';
+		};
+
+		for (const auto& [name, stats] : collectStats(*this)) {
+			prefix() << name << ',' << stats.count << ',' << stats.min << ',' << stats.mean << ','
+				<< stats.p50 << ',' << stats.p95 << ',' << stats.p99 << ',' << stats.max << '\n';
+		}
+
+		// One-off costs only fill the single sample columns
+		std::pair<const char*, double> totals[] = { { "startup", startupMs }, { "upload", uploadMs }, { "pipeline", pipelineMs }, { "model_load", modelLoadMs } };
+		for (const auto& [name, value] : totals) {
+			prefix() << name << ",1," << value << ',' << value << ',' << value << ',' << value << ',' << value << ',' << value << '\n';
+		}
+	}
+
+	void BenchReport::writeJson(std::ostream& out) const
+	{
+		out << std::fixed << std::setprecision(4);
+		out << "{\n";
+		out << "  \"scene\": \"" << scene << "\",\n";
+		out << "  \"objects\": " << objectCount << ",\n";
+		out << "  \"frames\": " << frameCount << ",\n";
+		out << "  \"width\": " << width << ",\n";
+		out << "  \"height\": " << height << ",\n";
+		out << "  \"gpu_culling\": " << (gpuCulling ? "true" : "false") << ",\n";
+		out << "  \"startup_ms\": " << startupMs << ",\n";
+		out << "  \"upload_ms\": " << uploadMs << ",\n";
+		out << "  \"pipeline_ms\": " << pipelineMs << ",\n";
+		out << "  \"model_load_ms\": " << modelLoadMs << ",\n";
+		out << "  \"metrics\": {";
+
+		bool first = true;
+		for (const auto& [name, stats] : collectStats(*this)) {
+			out << (first ? "\n" : ",\n");
+			out << "    \"" << name << "\": { \"count\": " << stats.count
+				<< ", \"min_ms\": " << stats.min << ", \"mean_ms\": " << stats.mean
+				<< ", \"p50_ms\": " << stats.p50 << ", \"p95_ms\": " << stats.p95
+				<< ", \"p99_ms\": " << stats.p99 << ", \"max_ms\": " << stats.max << " }";
+			first = false;
+		}
+
+		out << "\n  }\n}\n";
+	}
+
+	void BenchReport::print(std::ostream& out) const
+	{
+		out << std::fixed << std::setprecision(3);
+		out << "Scene: " << scene << " (" << objectCount << " objects, " << frameCount << " frames, "
+			<< width << "x" << height << (gpuCulling ? ", GPU culled" : "") << ")\n";
+		out << "Startup: " << startupMs << " ms, upload: " << uploadMs << " ms, pipelines: " << pipelineMs << " ms";
+		if (modelLoadMs > 0.0) {
+			out << ", model load: " << modelLoadMs << " ms";
+		}
+		out << "\n";
+
+		out << std::left << std::setw(12) << "metric" << std::right
+			<< std::setw(10) << "p50" << std::setw(10) << "p95" << std::setw(10) << "p99"
+			<< std::setw(10) << "mean" << std::setw(10) << "max" << "\n";
+
+		for (const auto& [name, stats] : collectStats(*this)) {
+			out << std::left << std::setw(12) << name << std::right
+				<< std::setw(10) << stats.p50 << std::setw(10) << stats.p95 << std::setw(10) << stats.p99
+				<< std::setw(10) << stats.mean << std::setw(10) << stats.max << "\n";
+		}
+	}
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace sde {
+
+	struct BenchStats {
+		size_t count = 0;
+		double min = 0.0, mean = 0.0, p50 = 0.0, p95 = 0.0, p99 = 0.0, max = 0.0;
+
+		static BenchStats compute(std::vector<double> samples);
+	};
+
+	struct BenchReport {
+		std::string scene;
+		uint32_t objectCount = 0;
+		uint32_t frameCount = 0;
+		uint32_t width = 0, height = 0;
+		bool gpuCulling = false; // Only the indirect scene culls, and only with drawIndirectFirstInstance
+
+		// One-off costs, in milliseconds
+		double startupMs = 0.0;
+		double uploadMs = 0.0;
+		double pipelineMs = 0.0;
+		double modelLoadMs = 0.0; // Only with --model
+
+		// Per frame samples, in milliseconds
+		std::vector<double> frameMs;
+		std::vector<double> beginFrameMs;
+		std::vector<double> recordMs;
+		std::vector<double> endFrameMs;
+		std::vector<double> cullMs;     // Only filled by the cpucull scene
+		std::vector<double> gpuFrameMs; // One per frame read back, the last frames in flight never are
+
+		void writeCsv(std::ostream& out) const;
+		void writeJson(std::ostream& out) const;
+		void print(std::ostream& out) const;
+	};
+
+}
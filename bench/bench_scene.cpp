@@ -0,0 +1,385 @@
+#include "bench_scene.h"
+
+#include "sde_upload_manager.h"
+#include "sde_trace.h"
+#include "sde_shaders.h"
+#include "sde_shader_variants.h"
+
+#include "glm/gtc/matrix_transform.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+namespace sde {
+
+	using BenchClock = std::chrono::steady_clock;
+
+	static double elapsedMs(BenchClock::time_point start, BenchClock::time_point end)
+	{
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+
+	bool BenchConfig::parseScene(const std::string& name, BenchSceneType& scene)
+	{
+		if (name == "instanced") scene = BenchSceneType::Instanced;
+		else if (name == "models") scene = BenchSceneType::Models;
+		else if (name == "pipelines") scene = BenchSceneType::Pipelines;
+		else if (name == "resize") scene = BenchSceneType::ResizeStorm;
+		else if (name == "indirect") scene = BenchSceneType::Indirect;
+		else if (name == "cpucull") scene = BenchSceneType::CpuCull;
+		else if (name == "hwinstanced") scene = BenchSceneType::HwInstanced;
+		else if (name == "variants") scene = BenchSceneType::Variants;
+		else return false;
+
+		return true;
+	}
+
+	const char* BenchConfig::sceneName(BenchSceneType scene)
+	{
+		switch (scene) {
+		case BenchSceneType::Instanced: return "instanced";
+		case BenchSceneType::Models: return "models";
+		case BenchSceneType::Pipelines: return "pipelines";
+		case BenchSceneType::ResizeStorm: return "resize";
+		case BenchSceneType::Indirect: return "indirect";
+		case BenchSceneType::CpuCull: return "cpucull";
+		case BenchSceneType::HwInstanced: return "hwinstanced";
+		case BenchSceneType::Variants: return "variants";
+		}
+		return "unknown";
+	}
+
+	BenchScene::BenchScene(const BenchConfig& config) : m_Config(config)
+	{
+		m_Report.scene = BenchConfig::sceneName(config.scene);
+		m_Report.objectCount = config.objectCount;
+		m_Report.width = config.width;
+		m_Report.height = config.height;
+
+		auto startupStart = BenchClock::now();
+		m_SdeDevice = std::make_unique<SdeDevice>();
+		if (config.threadCount > 1) {
+			m_JobSystem = std::make_unique<SdeJobSystem>(config.threadCount - 1);
+		}
+		SdeRendererConfig rendererConfig;
+		rendererConfig.swapChain.framesInFlight = config.framesInFlight;
+		rendererConfig.lowLatency = config.lowLatency;
+		m_SdeRenderer = std::make_unique<SdeRenderer>(*m_SdeDevice, vk::Extent2D{ config.width, config.height }, rendererConfig);
+		m_MeshPool = std::make_unique<SdeMeshPool>(*m_SdeDevice, sizeof(SdeModel::Vertex));
+		m_DrawList = std::make_unique<SdeIndirectDrawList>(*m_SdeDevice, *m_MeshPool, std::max(config.objectCount, 1u));
+		bool gpuCulling = m_DrawList->enableGpuCulling(shaders::cull_comp);
+		m_Report.gpuCulling = gpuCulling && config.scene == BenchSceneType::Indirect;
+
+		// One uniform block per draw, 256 bytes is the largest offset alignment in practice
+		vk::DeviceSize ringFrameSize = std::max<vk::DeviceSize>(SdeUniformRing::DEFAULT_FRAME_SIZE, 256 * static_cast<vk::DeviceSize>(config.objectCount));
+		m_SdeRenderer->setUniformRingSize(ringFrameSize);
+		m_SdeRenderer->setJobSystem(m_JobSystem.get());
+		m_SceneDescriptors = std::make_unique<SdeSceneDescriptors>(*m_SdeDevice, *m_SdeRenderer, m_DrawList->getDescriptorSetLayout());
+		m_Report.startupMs = elapsedMs(startupStart, BenchClock::now());
+
+		auto pipelineStart = BenchClock::now();
+		createPipelines();
+		m_Report.pipelineMs = elapsedMs(pipelineStart, BenchClock::now());
+
+		auto uploadStart = BenchClock::now();
+		createModels();
+
+		// Uploads are only batched by the models, include the GPU copy in the measurement
+		auto& uploadManager = m_SdeDevice->uploadManager();
+		uploadManager.wait(uploadManager.flush());
+		m_Report.uploadMs = elapsedMs(uploadStart, BenchClock::now()) - m_Report.modelLoadMs;
+
+		if (config.scene == BenchSceneType::HwInstanced) {
+			std::vector<SdeModel::InstanceData> instances(config.objectCount);
+			for (uint32_t i = 0; i < config.objectCount; i++) {
+				instances[i].transform = glm::translate(glm::mat4(1.0f), gridPosition(i));
+				instances[i].color = glm::vec4(static_cast<float>(i % 7) / 6.0f, 1.0f, 1.0f, 1.0f);
+			}
+
+			m_InstanceBuffer = std::make_unique<SdeBuffer>(
+				*m_SdeDevice,
+				sizeof(SdeModel::InstanceData) * instances.size(),
+				vk::BufferUsageFlagBits::eVertexBuffer,
+				vma::AllocationCreateFlagBits::eMapped | vma::AllocationCreateFlagBits::eHostAccessSequentialWrite
+			);
+			m_InstanceBuffer->writeTo(instances.data());
+		}
+
+		if (config.scene == BenchSceneType::CpuCull) {
+			const auto& sphere = m_Models[0]->getBoundingSphere();
+			m_CpuCuller.reserve(config.objectCount);
+			for (uint32_t i = 0; i < config.objectCount; i++) {
+				m_CpuCuller.addObject(gridPosition(i) + glm::vec3(sphere), sphere.w);
+			}
+		}
+	}
+
+	BenchScene::~BenchScene()
+	{
+		m_SdeDevice->device().waitIdle();
+
+		m_Models.clear();
+		m_InstanceBuffer.reset();
+		m_DrawList.reset();
+		m_MeshPool.reset();
+		m_Pipelines.clear();
+		m_SceneDescriptors.reset();
+		m_SdeRenderer.reset();
+		m_JobSystem.reset();
+	}
+
+	BenchReport BenchScene::run()
+	{
+		uint32_t totalFrames = m_Config.warmupFrames + m_Config.frameCount;
+
+		m_Report.frameMs.reserve(m_Config.frameCount);
+		m_Report.beginFrameMs.reserve(m_Config.frameCount);
+		m_Report.recordMs.reserve(m_Config.frameCount);
+		m_Report.endFrameMs.reserve(m_Config.frameCount);
+
+		SDE_TRACE_THREAD_NAME("Main");
+
+		for (uint32_t frame = 0; frame < totalFrames; frame++) {
+			SDE_TRACE_ZONE("Frame");
+			applyResize(frame);
+
+			auto frameStart = BenchClock::now();
+			auto commandBuffer = m_SdeRenderer->beginFrame();
+			auto beginEnd = BenchClock::now();
+
+			// Swapchain was recreated, nothing was recorded
+			if (!commandBuffer) continue;
+
+			recordScene(commandBuffer, m_SdeRenderer->getFrameIndex());
+			auto recordEnd = BenchClock::now();
+
+			m_SdeRenderer->endFrame();
+			auto frameEnd = BenchClock::now();
+
+			if (frame < m_Config.warmupFrames) continue;
+
+			m_Report.frameMs.push_back(elapsedMs(frameStart, frameEnd));
+			m_Report.beginFrameMs.push_back(elapsedMs(frameStart, beginEnd));
+			m_Report.recordMs.push_back(elapsedMs(beginEnd, recordEnd));
+			m_Report.endFrameMs.push_back(elapsedMs(recordEnd, frameEnd));
+			if (m_Config.scene == BenchSceneType::CpuCull) {
+				m_Report.cullMs.push_back(m_LastCullMs);
+			}
+
+			// beginFrame read back the frame that last used this slot, skip readbacks of warmup frames
+			auto& gpuProfiler = m_SdeRenderer->gpuProfiler();
+			SdeGpuScopeStats gpuStats;
+			bool measuredReadback = frame >= m_Config.warmupFrames + m_SdeRenderer->getFramesInFlight();
+			if (gpuProfiler.hasFreshSamples() && measuredReadback && gpuProfiler.getScopeStats("Frame", gpuStats)) {
+				m_Report.gpuFrameMs.push_back(gpuStats.lastMs);
+			}
+		}
+
+		m_SdeDevice->device().waitIdle();
+		m_Report.frameCount = static_cast<uint32_t>(m_Report.frameMs.size());
+
+		return m_Report;
+	}
+
+	void BenchScene::createPipelines()
+	{
+		uint32_t pipelineCount = m_Config.scene == BenchSceneType::Pipelines ? m_Config.objectCount : 1;
+		// Draw list draws read their transforms from the object buffer
+		SdeShaderCode vertexShader = shaders::shader_vert;
+		if (m_Config.scene == BenchSceneType::Indirect || m_Config.scene == BenchSceneType::CpuCull) {
+			vertexShader = shaders::indirect_vert;
+		}
+		else if (m_Config.scene == BenchSceneType::HwInstanced) {
+			vertexShader = shaders::instanced_vert;
+		}
+
+		PipelineConfigInfo configInfo;
+		if (m_Config.scene == BenchSceneType::HwInstanced) {
+			SdePipeline::instancedPipelineConfigInfo(configInfo);
+		}
+		else {
+			SdePipeline::defaultPipelineConfigInfo(configInfo);
+		}
+		configInfo.renderPass = m_SdeRenderer->getSwapChainRenderPass();
+		configInfo.pipelineLayout = m_SceneDescriptors->getPipelineLayout();
+
+		if (m_Config.scene == BenchSceneType::Variants) {
+			SdeShaderVariantSet fragmentVariants;
+			fragmentVariants.addOption("grayscale", SdeShaderConstantIds::GRAYSCALE, { VK_FALSE, VK_TRUE });
+
+			for (uint32_t i = 0; i < fragmentVariants.getVariantCount(); i++) {
+				configInfo.specialization = fragmentVariants.getConstants(i);
+				m_Pipelines.push_back(std::make_unique<SdePipeline>(*m_SdeDevice, vertexShader, shaders::shader_frag, configInfo));
+			}
+			return;
+		}
+
+		for (uint32_t i = 0; i < pipelineCount; i++) {
+			m_Pipelines.push_back(std::make_unique<SdePipeline>(
+				*m_SdeDevice,
+				vertexShader,
+				shaders::shader_frag,
+				configInfo
+			));
+		}
+	}
+
+	void BenchScene::createModels()
+	{
+		uint32_t modelCount = m_Config.scene == BenchSceneType::Models ? m_Config.objectCount : 1;
+
+		if (!m_Config.modelPath.empty()) {
+			// Parsed once on the job system, every model uploads its own copy
+			auto loadStart = BenchClock::now();
+			SdeModel::Builder builder;
+			builder.loadModel(m_Config.modelPath, m_JobSystem.get());
+			m_Report.modelLoadMs = elapsedMs(loadStart, BenchClock::now());
+
+			for (uint32_t i = 0; i < modelCount; i++) {
+				m_Models.push_back(std::make_unique<SdeModel>(*m_MeshPool, builder));
+			}
+			return;
+		}
+
+		for (uint32_t i = 0; i < modelCount; i++) {
+			// Slightly different geometry per model so no two uploads are identical
+			float offset = static_cast<float>(i % 100) * 0.001f;
+
+			SdeModel::Builder builder;
+			builder.vertices = {
+				{{  0.5f + offset,  0.5f, 0.0f }, {1.0f, 0.0f, 0.0f}},
+				{{ -0.5f,  0.5f + offset, 0.0f }, {0.0f, 1.0f, 0.0f}},
+				{{  0.5f, -0.5f - offset, 0.0f }, {0.0f, 0.0f, 1.0f}},
+				{{ -0.5f - offset, -0.5f, 0.0f }, {0.5f, 0.25f, 0.8f}}
+			};
+			builder.indices = { 1, 2, 3, 0, 1, 2 };
+
+			m_Models.push_back(std::make_unique<SdeModel>(*m_MeshPool, builder));
+		}
+	}
+
+	glm::vec3 BenchScene::gridPosition(uint32_t index)
+	{
+		// Grid wider than the view so culling has work to do
+		float x = static_cast<float>(index % 128) * 0.1f - 6.4f;
+		float y = static_cast<float>(index / 128 % 128) * 0.1f - 6.4f;
+		float z = static_cast<float>(index / (128 * 128)) * -0.1f;
+		return glm::vec3(x, y, z);
+	}
+
+	void BenchScene::recordScene(vk::CommandBuffer commandBuffer, int frameIndex)
+	{
+		vk::PipelineLayout pipelineLayout = m_SceneDescriptors->getPipelineLayout();
+
+		GlobalUbo ubo = {};
+		ubo.viewProjection = glm::perspective(glm::radians(45.0f), m_SdeRenderer->getAspectRatio(), 0.1f, 10.0f)
+			* glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+		m_SceneDescriptors->getUboBuffer(frameIndex).writeTo(&ubo);
+
+		if (m_Config.scene == BenchSceneType::CpuCull) {
+			auto cullStart = BenchClock::now();
+			m_CpuCuller.cull(SdeFrustum::fromMatrix(ubo.viewProjection), m_VisibleObjects, m_JobSystem.get());
+			m_LastCullMs = elapsedMs(cullStart, BenchClock::now());
+
+			m_DrawList->begin(frameIndex);
+			for (uint32_t index : m_VisibleObjects) {
+				m_DrawList->addDraw(*m_Models[0], glm::translate(glm::mat4(1.0f), gridPosition(index)));
+			}
+
+			m_SdeRenderer->beginSwapChainRenderPass(commandBuffer);
+
+			m_Pipelines[0]->bind(commandBuffer);
+			commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, m_SceneDescriptors->getGlobalSet(frameIndex), nullptr);
+			m_DrawList->draw(commandBuffer, pipelineLayout, 1);
+
+			m_SdeRenderer->endSwapChainRenderPass(commandBuffer);
+			return;
+		}
+
+		if (m_Config.scene == BenchSceneType::Indirect) {
+			// The dispatch goes before the render pass
+			m_DrawList->begin(frameIndex);
+			for (uint32_t i = 0; i < m_Config.objectCount; i++) {
+				m_DrawList->addDraw(*m_Models[0], glm::translate(glm::mat4(1.0f), gridPosition(i)));
+			}
+			m_DrawList->cull(commandBuffer, ubo.viewProjection);
+
+			m_SdeRenderer->beginSwapChainRenderPass(commandBuffer);
+
+			m_Pipelines[0]->bind(commandBuffer);
+			commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, m_SceneDescriptors->getGlobalSet(frameIndex), nullptr);
+			m_DrawList->draw(commandBuffer, pipelineLayout, 1);
+
+			m_SdeRenderer->endSwapChainRenderPass(commandBuffer);
+			return;
+		}
+
+		if (m_JobSystem && m_Config.scene != BenchSceneType::HwInstanced) {
+			m_SdeRenderer->beginSwapChainRenderPass(commandBuffer, vk::SubpassContents::eSecondaryCommandBuffers);
+			m_SdeRenderer->recordParallel(commandBuffer, m_Config.objectCount, [&](vk::CommandBuffer secondary, uint32_t begin, uint32_t end) {
+				recordDraws(secondary, frameIndex, begin, end);
+			});
+			m_SdeRenderer->endSwapChainRenderPass(commandBuffer);
+			return;
+		}
+
+		m_SdeRenderer->beginSwapChainRenderPass(commandBuffer);
+
+		if (m_Config.scene == BenchSceneType::HwInstanced) {
+			m_MeshPool->bind(commandBuffer);
+			m_Pipelines[0]->bind(commandBuffer);
+			commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, m_SceneDescriptors->getGlobalSet(frameIndex), nullptr);
+			m_Models[0]->drawInstanced(commandBuffer, m_InstanceBuffer->getBuffer(), m_Config.objectCount);
+
+			m_SdeRenderer->endSwapChainRenderPass(commandBuffer);
+			return;
+		}
+
+		recordDraws(commandBuffer, frameIndex, 0, m_Config.objectCount);
+
+		m_SdeRenderer->endSwapChainRenderPass(commandBuffer);
+	}
+
+	void BenchScene::recordDraws(vk::CommandBuffer commandBuffer, int frameIndex, uint32_t begin, uint32_t end)
+	{
+		vk::PipelineLayout pipelineLayout = m_SceneDescriptors->getPipelineLayout();
+
+		// All models share the mesh pool buffers
+		m_MeshPool->bind(commandBuffer);
+
+		for (uint32_t i = begin; i < end; i++) {
+			// Only rebind what actually changes between draws, like a real scene would
+			if (i == begin || m_Pipelines.size() > 1) {
+				auto& pipeline = m_Pipelines[i % m_Pipelines.size()];
+				pipeline->bind(commandBuffer);
+
+				commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, m_SceneDescriptors->getGlobalSet(frameIndex), nullptr);
+			}
+
+			ObjectUniforms objectUniforms = {};
+			objectUniforms.tint = glm::vec4(static_cast<float>(i % 7) / 6.0f, 1.0f, 1.0f, 1.0f);
+			uint32_t objectOffset = m_SdeRenderer->uniformRing().push(objectUniforms);
+			commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 2, m_SceneDescriptors->getObjectSet(), objectOffset);
+
+			m_SdeRenderer->pushObjectConstants(commandBuffer, pipelineLayout, glm::translate(glm::mat4(1.0f), gridPosition(i)), i);
+			m_Models[i % m_Models.size()]->draw(commandBuffer);
+		}
+	}
+
+	void BenchScene::applyResize(uint32_t frame)
+	{
+		if (m_Config.scene != BenchSceneType::ResizeStorm || m_Config.resizeInterval == 0) return;
+		if (frame == 0 || frame % m_Config.resizeInterval != 0) return;
+
+		// Alternate between the full and a half size target
+		bool shrink = (frame / m_Config.resizeInterval) % 2 == 1;
+		vk::Extent2D extent = { m_Config.width, m_Config.height };
+		if (shrink) {
+			extent.width = std::max(1u, extent.width / 2);
+			extent.height = std::max(1u, extent.height / 2);
+		}
+
+		m_SdeRenderer->resize(extent);
+	}
+
+}
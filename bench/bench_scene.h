@@ -0,0 +1,91 @@
+#pragma once
+
+#include "bench_report.h"
+
+#include "sde_device.h"
+#include "sde_renderer.h"
+#include "sde_model.h"
+#include "sde_pipeline.h"
+#include "sde_descriptors.h"
+#include "sde_scene_descriptors.h"
+#include "sde_indirect_draw.h"
+#include "sde_cpu_culling.h"
+#include "sde_job_system.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sde {
+
+	enum class BenchSceneType {
+		Instanced,    // One model drawn N times
+		Models,       // N distinct models, one draw each
+		Pipelines,    // N pipelines, one bind + draw each
+		ResizeStorm,  // Instanced scene while the target is resized continuously
+		Indirect,     // N draws of one model through SdeIndirectDrawList, culled on the GPU
+		CpuCull,      // Same grid culled by SdeCpuCuller, visible draws go through the draw list
+		HwInstanced,  // One model drawn N times with a single drawInstanced
+		Variants      // N draws alternating between the specialization variants of shader.frag
+	};
+
+	struct BenchConfig {
+		BenchSceneType scene = BenchSceneType::Instanced;
+		uint32_t objectCount = 1000;
+		uint32_t frameCount = 1000;
+		uint32_t warmupFrames = 16;
+		uint32_t width = 1280;
+		uint32_t height = 720;
+		uint32_t resizeInterval = 1;
+		// Threads culling and recording draws, 1 keeps everything on the main thread
+		uint32_t threadCount = 1;
+		// Headless, so the present mode and image count of the renderer config do not apply
+		uint32_t framesInFlight = 2;
+		bool lowLatency = false;
+		// OBJ file loaded through SdeModel::Builder::loadModel instead of the built-in quad
+		std::string modelPath;
+
+		static bool parseScene(const std::string& name, BenchSceneType& scene);
+		static const char* sceneName(BenchSceneType scene);
+	};
+
+	class BenchScene {
+	public:
+		BenchScene(const BenchConfig& config);
+		~BenchScene();
+
+		BenchScene(const BenchScene&) = delete;
+		BenchScene& operator=(const BenchScene&) = delete;
+
+		BenchReport run();
+
+	private:
+		void createPipelines();
+		void createModels();
+		void recordScene(vk::CommandBuffer commandBuffer, int frameIndex);
+		void recordDraws(vk::CommandBuffer commandBuffer, int frameIndex, uint32_t begin, uint32_t end);
+		void applyResize(uint32_t frame);
+
+		static glm::vec3 gridPosition(uint32_t index);
+
+	private:
+		BenchConfig m_Config;
+		BenchReport m_Report;
+
+		std::unique_ptr<SdeDevice> m_SdeDevice;
+		std::unique_ptr<SdeJobSystem> m_JobSystem;
+		std::unique_ptr<SdeRenderer> m_SdeRenderer;
+		std::unique_ptr<SdeMeshPool> m_MeshPool;
+		std::unique_ptr<SdeIndirectDrawList> m_DrawList;
+		SdeCpuCuller m_CpuCuller;
+		std::vector<uint32_t> m_VisibleObjects;
+		double m_LastCullMs = 0.0;
+
+		std::vector<std::unique_ptr<SdePipeline>> m_Pipelines;
+		std::vector<std::unique_ptr<SdeModel>> m_Models;
+		std::unique_ptr<SdeBuffer> m_InstanceBuffer;
+
+		std::unique_ptr<SdeSceneDescriptors> m_SceneDescriptors;
+	};
+
+}
@@ -0,0 +1,167 @@
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "glm/glm.hpp"
+
+#include "bench_scene.h"
+#include "sde_trace.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vulkan/vulkan.hpp>
+
+static void printUsage()
+{
+	std::cout <<
+		"Usage: SdEngineBench [options]\n"
+		"  --scene <instanced|models|pipelines|resize|indirect|cpucull|hwinstanced|variants>  Scene to run (default: instanced)\n"
+		"  --objects <n>          Draws/models/pipelines in the scene (default: 1000)\n"
+		"  --frames <n>           Measured frames (default: 1000)\n"
+		"  --warmup <n>           Unmeasured frames before measuring (default: 16)\n"
+		"  --width <n>            Target width (default: 1280)\n"
+		"  --height <n>           Target height (default: 720)\n"
+		"  --resize-interval <n>  Frames between resizes in the resize scene (default: 1)\n"
+		"  --threads <n>          Threads culling (cpucull) and recording draws into secondary command buffers (default: 1)\n"
+		"  --frames-in-flight <n> Frames the CPU may run ahead of the GPU, 1 to 4 (default: 2)\n"
+		"  --low-latency          Wait for the GPU to drain before every frame\n"
+		"  --model <file.obj>     Draw this OBJ instead of the built-in quad, parsed on --threads threads\n"
+		"  --out <file>           Write the report as .csv or .json\n"
+		"  --trace <file>         Write a Chrome/Perfetto CPU trace (needs SDE_ENABLE_TRACING)\n";
+}
+
+static bool endsWith(const std::string& value, const std::string& suffix)
+{
+	return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// stoull wraps a leading '-' around instead of throwing, and the value may not fit 32 bits
+static uint32_t parseUint32(const std::string& value)
+{
+	size_t first = value.find_first_not_of(" \t\n\v\f\r");
+	if (first == std::string::npos || value[first] == '-') {
+		throw std::invalid_argument(value);
+	}
+
+	size_t parsed = 0;
+	unsigned long long result = std::stoull(value, &parsed);
+	if (parsed != value.size()) {
+		throw std::invalid_argument(value);
+	}
+	if (result > UINT32_MAX) {
+		throw std::out_of_range(value);
+	}
+	return static_cast<uint32_t>(result);
+}
+
+int main(int argc, char** argv) {
+	sde::BenchConfig config;
+	std::string outPath;
+	std::string tracePath;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (arg == "--help" || arg == "-h") {
+			printUsage();
+			return 0;
+		}
+
+		if (arg == "--low-latency") {
+			config.lowLatency = true;
+			continue;
+		}
+
+		if (!hasValue) {
+			std::cout << "Missing value for " << arg << "\n";
+			printUsage();
+			return 1;
+		}
+
+		std::string value = argv[++i];
+		// parseUint32 throws on values that are not unsigned 32 bit numbers
+		try {
+			if (arg == "--scene") {
+				if (!sde::BenchConfig::parseScene(value, config.scene)) {
+					std::cout << "Unknown scene: " << value << "\n";
+					return 1;
+				}
+			}
+			else if (arg == "--objects") config.objectCount = parseUint32(value);
+			else if (arg == "--frames") config.frameCount = parseUint32(value);
+			else if (arg == "--warmup") config.warmupFrames = parseUint32(value);
+			else if (arg == "--width") config.width = parseUint32(value);
+			else if (arg == "--height") config.height = parseUint32(value);
+			else if (arg == "--resize-interval") config.resizeInterval = parseUint32(value);
+			else if (arg == "--threads") config.threadCount = parseUint32(value);
+			else if (arg == "--frames-in-flight") config.framesInFlight = parseUint32(value);
+			else if (arg == "--model") config.modelPath = value;
+			else if (arg == "--out") outPath = value;
+			else if (arg == "--trace") tracePath = value;
+			else {
+				std::cout << "Unknown option: " << arg << "\n";
+				printUsage();
+				return 1;
+			}
+		}
+		catch (const std::logic_error&) {
+			std::cout << "Invalid value for " << arg << ": " << value << "\n";
+			printUsage();
+			return 1;
+		}
+	}
+
+	if (config.objectCount == 0 || config.width == 0 || config.height == 0) {
+		std::cout << "Objects, width and height must be greater than zero\n";
+		return 1;
+	}
+
+	if (config.framesInFlight < 1 || config.framesInFlight > sde::SdeSwapChain::MAX_FRAMES_IN_FLIGHT) {
+		std::cout << "Frames in flight must be between 1 and " << sde::SdeSwapChain::MAX_FRAMES_IN_FLIGHT << "\n";
+		return 1;
+	}
+
+	try {
+		sde::BenchReport report;
+		{
+			sde::BenchScene scene(config);
+			report = scene.run();
+		}
+
+		report.print(std::cout);
+
+		if (!tracePath.empty()) {
+#ifdef SDE_ENABLE_TRACING
+			SDE_TRACE_DUMP(tracePath);
+#else
+			std::cout << "Tracing is compiled out, rebuild with -DSDE_ENABLE_TRACING=ON\n";
+#endif
+		}
+
+		if (!outPath.empty()) {
+			std::ofstream file(outPath);
+			if (!file.is_open()) {
+				std::cout << "Failed to open report file: " << outPath << "\n";
+				return 1;
+			}
+
+			if (endsWith(outPath, ".json")) report.writeJson(file);
+			else report.writeCsv(file);
+		}
+	}
+	catch (vk::SystemError& err)
+	{
+		std::cout << "vk::SystemError: " << err.what() << std::endl;
+		return 1;
+	}
+	catch (const std::exception& err)
+	{
+		std::cout << "std::exception " << err.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
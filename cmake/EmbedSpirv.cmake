@@ -0,0 +1,31 @@
+# Turns a SPIR-V binary into a header with a constexpr uint32_t array.
+# Usage: cmake -DINPUT=<file.spv> -DOUTPUT=<file.h> -DSYMBOL=<name> -P EmbedSpirv.cmake
+
+file(READ "${INPUT}" SPIRV_HEX HEX)
+string(LENGTH "${SPIRV_HEX}" SPIRV_HEX_LENGTH)
+math(EXPR SPIRV_REMAINDER "${SPIRV_HEX_LENGTH} % 8")
+if (SPIRV_HEX_LENGTH EQUAL 0 OR NOT SPIRV_REMAINDER EQUAL 0)
+  message(FATAL_ERROR "${INPUT} is not a SPIR-V binary")
+endif()
+
+# SPIR-V words are little endian, swap the bytes of every 8 hex digit group
+string(REGEX REPLACE "([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])" "0x\\4\\3\\2\\1," SPIRV_WORDS "${SPIRV_HEX}")
+# 8 words per line, CMake regexes have no {n} repetition
+set(SPIRV_WORD "0x[0-9a-f]+,")
+string(REGEX REPLACE "(${SPIRV_WORD}${SPIRV_WORD}${SPIRV_WORD}${SPIRV_WORD}${SPIRV_WORD}${SPIRV_WORD}${SPIRV_WORD}${SPIRV_WORD})" "\\1\n\t\t" SPIRV_WORDS "${SPIRV_WORDS}")
+
+get_filename_component(INPUT_NAME "${INPUT}" NAME)
+file(WRITE "${OUTPUT}"
+"// Generated from ${INPUT_NAME}, do not edit
+#pragma once
+
+#include <cstdint>
+
+namespace sde::shaders {
+
+	inline constexpr uint32_t ${SYMBOL}[] = {
+		${SPIRV_WORDS}
+	};
+
+}
+")
@@ -0,0 +1,27 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+    mat4 viewProjection;
+} ubo;
+
+struct ObjectData {
+    mat4 transform;
+    vec4 boundingSphere;
+    uint materialIndex;
+};
+
+// Indexed by firstInstance of each indirect draw
+layout(std430, set = 1, binding = 0) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+} objectBuffer;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+
+layout(location = 0) out vec3 fragColor;
+
+void main() {
+    ObjectData object = objectBuffer.objects[gl_InstanceIndex];
+    gl_Position = ubo.viewProjection * object.transform * vec4(inPosition, 1.0);
+    fragColor = inColor;
+}
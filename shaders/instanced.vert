@@ -0,0 +1,19 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+    mat4 viewProjection;
+} ubo;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+
+// Per instance, binding 1 (SdeModel::InstanceData)
+layout(location = 2) in mat4 instanceTransform;
+layout(location = 6) in vec4 instanceColor;
+
+layout(location = 0) out vec3 fragColor;
+
+void main() {
+    gl_Position = ubo.viewProjection * instanceTransform * vec4(inPosition, 1.0);
+    fragColor = inColor * instanceColor.rgb;
+}
@@ -1,17 +1,25 @@
 #version 450
 
 layout(binding = 0) uniform GlobalUbo {
-    mat4 projection;
-    mat4 view;
-	mat4 model;
+    mat4 viewProjection;
 } ubo;
 
+// Per draw block in the renderer's uniform ring, bound with a dynamic offset
+layout(set = 2, binding = 0) uniform ObjectUniforms {
+    vec4 tint;
+} objectUniforms;
+
+layout(push_constant) uniform ObjectPushConstants {
+    mat4 model;
+    uint objectId;
+} object;
+
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 
 layout(location = 0) out vec3 fragColor;
 
 void main() {
-    gl_Position = ubo.projection * ubo.view * ubo.model * vec4(inPosition, 1.0);
-    fragColor = inColor;
+    gl_Position = ubo.viewProjection * object.model * vec4(inPosition, 1.0);
+    fragColor = inColor * objectUniforms.tint.rgb;
 }
\ No newline at end of file
@@ -1,15 +1,16 @@
 #include "app.h"
+#include "sde_trace.h"
+#include "sde_shaders.h"
 
 namespace sde {
-	App::App()
+	App::App(const SdeRendererConfig& rendererConfig) : m_SdeRenderer(m_SdeWindow, m_SdeDevice, rendererConfig)
 	{
-		// Global pool
-		m_GlobalPool = SdeDescriptorPool::Builder(m_SdeDevice)
-			.setMaxSets(SdeSwapChain::MAX_FRAMES_IN_FLIGHT)
-			.addPoolSize(vk::DescriptorType::eUniformBuffer, SdeSwapChain::MAX_FRAMES_IN_FLIGHT)
-			.build();
+		m_SdeRenderer.setJobSystem(&m_JobSystem);
 
-		initUBO();
+		m_DrawList = std::make_unique<SdeIndirectDrawList>(m_SdeDevice, m_MeshPool);
+		m_DrawList->enableGpuCulling(shaders::cull_comp);
+
+		m_SceneDescriptors = std::make_unique<SdeSceneDescriptors>(m_SdeDevice, m_SdeRenderer, m_DrawList->getDescriptorSetLayout());
 
 		std::vector<SdeModel::Vertex> triangleVertices = {
 			{{0.0f, -0.5f, -1.0f}, {1.0f, 0.0f, 0.0f}},
@@ -32,14 +33,16 @@ namespace sde {
 		PipelineConfigInfo configInfo;
 		SdePipeline::defaultPipelineConfigInfo(configInfo);
 		configInfo.renderPass = m_SdeRenderer.getSwapChainRenderPass();
-		configInfo.pipelineLayout = m_PipelineLayout;
+		configInfo.pipelineLayout = m_SceneDescriptors->getPipelineLayout();
+
+		// Only the variant selected at build time is ever bound
+		SdeShaderVariantSet fragmentVariants;
+		fragmentVariants.addOption("grayscale", SdeShaderConstantIds::GRAYSCALE, { VK_FALSE, VK_TRUE });
+		configInfo.specialization = fragmentVariants.getConstants(fragmentVariants.getVariantIndex({ USE_GRAYSCALE ? VK_TRUE : VK_FALSE }));
 
-		m_DefaultPipeline = std::make_shared<SdePipeline>(
-			m_SdeDevice,
-			"../shaders/shader.vert.spv",
-			"../shaders/shader.frag.spv",
-			configInfo
-		);
+		// Compiled in the background. No fallback, the two pipelines read different per object data
+		m_DefaultPipeline = m_PipelineRegistry.request(shaders::shader_vert, shaders::shader_frag, configInfo);
+		m_IndirectPipeline = m_PipelineRegistry.request(shaders::indirect_vert, shaders::shader_frag, configInfo);
 
 		SdeModel::Builder triangleBuilder;
 		triangleBuilder.vertices = triangleVertices;
@@ -48,91 +51,92 @@ namespace sde {
 		rectangleBuilder.vertices = rectangleVertices;
 		rectangleBuilder.indices = rectangleIndices;
 
-		m_TriangleModel = std::make_unique<SdeModel>(m_SdeDevice, triangleBuilder);
-		m_RectangleModel = std::make_unique<SdeModel>(m_SdeDevice, rectangleBuilder);
+		m_TriangleModel = std::make_unique<SdeModel>(m_MeshPool, triangleBuilder);
+		m_RectangleModel = std::make_unique<SdeModel>(m_MeshPool, rectangleBuilder);
+
+		m_Objects.push_back({ m_RectangleModel.get(), glm::vec3(0.0f), glm::vec4(1.0f) });
+		m_Objects.push_back({ m_TriangleModel.get(), glm::vec3(0.0f, 0.0f, 0.5f), glm::vec4(1.0f, 0.5f, 0.5f, 1.0f) });
 	}
 
 	App::~App()
 	{
-		m_SdeDevice.device().destroyPipelineLayout(m_PipelineLayout);
+		m_PipelineRegistry.waitIdle();
 	}
 
-	void App::initUBO()
+	void App::updateTransforms(float time)
 	{
-		m_UboBuffers.resize(SdeSwapChain::MAX_FRAMES_IN_FLIGHT);
-		m_DescriptorSets.resize(SdeSwapChain::MAX_FRAMES_IN_FLIGHT);
-
-		// 1. Allocate UBO buffers
-		for (size_t i = 0; i < m_UboBuffers.size(); i++) {
-			m_UboBuffers[i] = std::make_unique<SdeBuffer>(
-				m_SdeDevice,
-				sizeof(GlobalUbo),
-				vk::BufferUsageFlagBits::eUniformBuffer,
-				vma::AllocationCreateFlagBits::eMapped | vma::AllocationCreateFlagBits::eHostAccessSequentialWrite
-			);
-		}
+		SDE_TRACE_FUNCTION();
 
-		// 2. Create set layout
-		m_DescriptorSetLayout = SdeDescriptorSetLayout::Builder(m_SdeDevice)
-			.addBinding(0, vk::DescriptorType::eUniformBuffer, vk::ShaderStageFlagBits::eAll)
-			.build();
-
-		// 3. Create descriptor sets
-		for (size_t i = 0; i < m_DescriptorSets.size(); i++) {
-			vk::DescriptorBufferInfo bufferInfo = {};
-			bufferInfo.buffer = m_UboBuffers[i]->getBuffer();
-			bufferInfo.offset = 0;
-			bufferInfo.range = sizeof(GlobalUbo);
-
-			m_DescriptorSets[i] = SdeDescriptorWriter(*m_DescriptorSetLayout, *m_GlobalPool)
-				.writeBuffer(0, &bufferInfo)
-				.build();
-		}
-
-		// TODO: Remove pipeline layout from here
-		// 
-		// 4. Create pipeline layout
-		std::vector<vk::DescriptorSetLayout> descriptorSetLayouts = { m_DescriptorSetLayout->getDescriptorSetLayout() };
-		vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
-		pipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-		pipelineLayoutCreateInfo.pSetLayouts = descriptorSetLayouts.data();
+		glm::mat4 spin = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
 
-		// 4.1 Add push constants
-
-		m_PipelineLayout = m_SdeDevice.device().createPipelineLayout(pipelineLayoutCreateInfo);
+		// Every object writes only its own transform, the ranges need no synchronization
+		SdeJobCounter counter;
+		m_JobSystem.parallelFor(static_cast<uint32_t>(m_Objects.size()), TRANSFORMS_PER_JOB, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) {
+				m_Objects[i].transform = glm::translate(spin, m_Objects[i].offset);
+			}
+		}, counter);
+		m_JobSystem.wait(counter);
 	}
 
 	void App::run()
 	{
+		SDE_TRACE_THREAD_NAME("Main");
+		SDE_TRACE_FUNCTION();
+
 		while (!m_SdeWindow.shouldClose()) {
+			SDE_TRACE_ZONE("Frame");
+
+			// Input is sampled as late as the configured latency allows
+			m_SdeRenderer.waitForFrame();
 			glfwPollEvents();
 			if (auto commandBuffer = m_SdeRenderer.beginFrame()) {
 				uint32_t frameIndex = m_SdeRenderer.getFrameIndex();
+				vk::PipelineLayout pipelineLayout = m_SceneDescriptors->getPipelineLayout();
 
-				m_SdeRenderer.beginSwapChainRenderPass(commandBuffer);
+				glm::mat4 projection = glm::perspective(glm::radians(45.0f), m_SdeRenderer.getAspectRatio(), 0.1f, 10.0f);
+				glm::mat4 view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+				updateTransforms(static_cast<float>(glfwGetTime()));
 
-				// Render
 				GlobalUbo ubo = {};
-				ubo.projection = glm::perspective(glm::radians(45.0f), m_SdeRenderer.getAspectRatio(), 0.1f, 10.0f);
-				ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-				ubo.model = glm::rotate(glm::mat4(1.0f), (float)glfwGetTime() * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-
-				m_UboBuffers[frameIndex]->writeTo(&ubo);
-
-				m_DefaultPipeline->bind(commandBuffer);
-
-				commandBuffer.bindDescriptorSets(
-					vk::PipelineBindPoint::eGraphics,
-					m_PipelineLayout,
-					0,
-					1,
-					&m_DescriptorSets[frameIndex], 
-					0, 
-					0
-				);
-
-				m_RectangleModel->bind(commandBuffer);
-				m_RectangleModel->draw(commandBuffer);
+				ubo.viewProjection = projection * view;
+
+				m_SceneDescriptors->getUboBuffer(frameIndex).writeTo(&ubo);
+
+				// Culling runs in compute, outside of the render pass
+				if (USE_INDIRECT_DRAW) {
+					m_DrawList->begin(frameIndex);
+					for (const auto& object : m_Objects) {
+						m_DrawList->addDraw(*object.model, object.transform);
+					}
+					m_DrawList->cull(commandBuffer, ubo.viewProjection);
+				}
+
+				m_SdeRenderer.beginSwapChainRenderPass(commandBuffer);
+
+				// Render, pipelines compile in the background so the first frames may only clear
+				SdePipelineHandle pipeline = USE_INDIRECT_DRAW ? m_IndirectPipeline : m_DefaultPipeline;
+				if (m_PipelineRegistry.bind(commandBuffer, pipeline)) {
+					commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, m_SceneDescriptors->getGlobalSet(frameIndex), nullptr);
+
+					if (USE_INDIRECT_DRAW) {
+						m_DrawList->draw(commandBuffer, pipelineLayout, 1);
+					}
+					else {
+						// Every model lives in the mesh pool, bind it once per frame
+						m_MeshPool.bind(commandBuffer);
+
+						auto& uniformRing = m_SdeRenderer.uniformRing();
+
+						for (uint32_t i = 0; i < m_Objects.size(); i++) {
+							const auto& object = m_Objects[i];
+							uint32_t objectOffset = uniformRing.push(ObjectUniforms{ object.tint });
+							commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 2, m_SceneDescriptors->getObjectSet(), objectOffset);
+							m_SdeRenderer.pushObjectConstants(commandBuffer, pipelineLayout, object.transform, i);
+							object.model->draw(commandBuffer);
+						}
+					}
+				}
 
 				m_SdeRenderer.endSwapChainRenderPass(commandBuffer);
 
@@ -5,25 +5,31 @@
 #include "sde_renderer.h"
 #include "sde_model.h"
 #include "sde_pipeline.h"
+#include "sde_pipeline_registry.h"
+#include "sde_shader_variants.h"
 #include "sde_descriptors.h"
+#include "sde_scene_descriptors.h"
+#include "sde_indirect_draw.h"
+#include "sde_job_system.h"
 
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 
 namespace sde {
 
-	struct GlobalUbo {
-		glm::mat4 projection{ 1.f };
-		glm::mat4 view{ 1.f };
-		glm::mat4 model{ 1.f };
-	};
-
 	class App {
 	public:
 		static constexpr int WIDTH = 800;
 		static constexpr int HEIGHT = 600;
 
-		App();
+		// Draw through SdeIndirectDrawList instead of one bind + draw per model
+		static constexpr bool USE_INDIRECT_DRAW = true;
+		// Picks the variant of shader.frag specialized with GRAYSCALE
+		static constexpr bool USE_GRAYSCALE = false;
+		// Smallest range of objects a transform update job handles
+		static constexpr uint32_t TRANSFORMS_PER_JOB = 256;
+
+		App(const SdeRendererConfig& rendererConfig = {});
 		~App();
 
 		App(const App&) = delete;
@@ -32,23 +38,31 @@ namespace sde {
 		void run();
 
 	private:
-		void initUBO();
+		struct SceneObject {
+			SdeModel* model = nullptr;
+			glm::vec3 offset{ 0.f }; // Applied before the shared spin
+			glm::vec4 tint{ 1.f };
+			glm::mat4 transform{ 1.f };
+		};
+
+		void updateTransforms(float time);
 
 	private:
 		SdeWindow m_SdeWindow{WIDTH, HEIGHT, "Application"};
 		SdeDevice m_SdeDevice{m_SdeWindow};
+		// Destroyed after everything that queues jobs, but before the device
+		SdeJobSystem m_JobSystem;
 		SdeRenderer m_SdeRenderer{ m_SdeWindow, m_SdeDevice };
+		SdeMeshPool m_MeshPool{ m_SdeDevice, sizeof(SdeModel::Vertex) };
+		SdePipelineRegistry m_PipelineRegistry{ m_SdeDevice, m_JobSystem };
 
-		vk::PipelineLayout m_PipelineLayout;
+		std::unique_ptr<SdeSceneDescriptors> m_SceneDescriptors;
 
-		std::shared_ptr<SdePipeline> m_DefaultPipeline;
+		SdePipelineHandle m_DefaultPipeline = SdePipelineRegistry::INVALID_PIPELINE;
+		SdePipelineHandle m_IndirectPipeline = SdePipelineRegistry::INVALID_PIPELINE;
+		std::unique_ptr<SdeIndirectDrawList> m_DrawList;
 		std::unique_ptr<SdeModel> m_TriangleModel, m_RectangleModel;
-
-		// TODO: Remove this from here
-		std::unique_ptr<SdeDescriptorSetLayout> m_DescriptorSetLayout;
-		std::unique_ptr<SdeDescriptorPool> m_GlobalPool;
-		std::vector<std::unique_ptr<SdeBuffer>> m_UboBuffers;
-		std::vector<vk::DescriptorSet> m_DescriptorSets;
+		std::vector<SceneObject> m_Objects;
 	};
 
 }
\ No newline at end of file
@@ -1,20 +1,93 @@
-#define VMA_IMPLEMENTATION
-#define VMA_STATIC_VULKAN_FUNCTIONS 0
-#define VMA_DYNAMIC_VULKAN_FUNCTION 1
-#include "vk_mem_alloc.hpp"
-
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include "glm/glm.hpp"
 
+#include <cstdint>
 #include <iostream>
+#include <stdexcept>
+#include <string>
 #include <vulkan/vulkan.hpp>
 #include "app.h"
+#include "sde_trace.h"
+
+static void printUsage()
+{
+	std::cout <<
+		"Usage: SdEngine [options]\n"
+		"  --frames-in-flight <n>  Frames the CPU may run ahead of the GPU, 1 to 4 (default: 2)\n"
+		"  --images <n>            Swapchain images, 0 for one more than the surface minimum (default: 0)\n"
+		"  --present-mode <immediate|mailbox|fifo|fifo-relaxed>  Falls back to fifo when unsupported (default: mailbox)\n"
+		"  --low-latency           Wait for the GPU to drain before sampling input\n";
+}
+
+// stoull wraps a leading '-' around instead of throwing, and the value may not fit 32 bits
+static uint32_t parseUint32(const std::string& value)
+{
+	size_t first = value.find_first_not_of(" \t\n\v\f\r");
+	if (first == std::string::npos || value[first] == '-') {
+		throw std::invalid_argument(value);
+	}
+
+	size_t parsed = 0;
+	unsigned long long result = std::stoull(value, &parsed);
+	if (parsed != value.size()) {
+		throw std::invalid_argument(value);
+	}
+	if (result > UINT32_MAX) {
+		throw std::out_of_range(value);
+	}
+	return static_cast<uint32_t>(result);
+}
+
+int main(int argc, char** argv) {
+	sde::SdeRendererConfig rendererConfig;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+
+		if (arg == "--help" || arg == "-h") {
+			printUsage();
+			return 0;
+		}
+		if (arg == "--low-latency") {
+			rendererConfig.lowLatency = true;
+			continue;
+		}
+
+		if (i + 1 >= argc) {
+			std::cout << "Missing value for " << arg << "\n";
+			printUsage();
+			return 1;
+		}
+
+		std::string value = argv[++i];
+		// parseUint32 throws on values that are not unsigned 32 bit numbers
+		try {
+			if (arg == "--frames-in-flight") rendererConfig.swapChain.framesInFlight = parseUint32(value);
+			else if (arg == "--images") rendererConfig.swapChain.imageCount = parseUint32(value);
+			else if (arg == "--present-mode") {
+				if (!sde::SdeSwapChainConfig::parsePresentMode(value, rendererConfig.swapChain.presentMode)) {
+					std::cout << "Unknown present mode: " << value << "\n";
+					return 1;
+				}
+			}
+			else {
+				std::cout << "Unknown option: " << arg << "\n";
+				printUsage();
+				return 1;
+			}
+		}
+		catch (const std::logic_error&) {
+			std::cout << "Invalid value for " << arg << ": " << value << "\n";
+			printUsage();
+			return 1;
+		}
+	}
 
-int main() {
 	try {
-		sde::App app;
+		sde::App app(rendererConfig);
 		app.run();
+		SDE_TRACE_DUMP("sde_trace.json");
 	}
 	catch (vk::SystemError& err)
 	{
@@ -1,4 +1,5 @@
 #include "sde_buffer.h"
+#include "sde_deletion_queue.h"
 
 namespace sde {
 	SdeBuffer::SdeBuffer(
@@ -21,7 +22,12 @@ namespace sde {
 
 	SdeBuffer::~SdeBuffer()
 	{
-		m_Device.getAllocator().destroyBuffer(m_Buffer, m_Allocation);
+		vma::Allocator allocator = m_Device.getAllocator();
+		vk::Buffer buffer = m_Buffer;
+		vma::Allocation allocation = m_Allocation;
+		m_Device.deletionQueue().push([allocator, buffer, allocation]() {
+			allocator.destroyBuffer(buffer, allocation);
+		});
 	}
 
 	vk::Result SdeBuffer::map()
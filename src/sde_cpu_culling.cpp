@@ -0,0 +1,202 @@
+#include "sde_cpu_culling.h"
+#include "sde_trace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#if defined(__AVX__)
+	#define SDE_CULL_AVX
+	#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define SDE_CULL_SSE
+	#include <emmintrin.h>
+#endif
+
+namespace sde {
+
+	static uint32_t roundUp(uint32_t value, uint32_t multiple)
+	{
+		return (value + multiple - 1) / multiple * multiple;
+	}
+
+	uint32_t SdeCpuCuller::addObject(const glm::vec3& center, float radius)
+	{
+		uint32_t index = m_Count++;
+
+		// Padding lanes get a negative infinite radius so they always fail the plane test
+		uint32_t paddedCount = roundUp(m_Count, LANE_PADDING);
+		if (paddedCount > m_Radius.size()) {
+			m_CenterX.resize(paddedCount, 0.0f);
+			m_CenterY.resize(paddedCount, 0.0f);
+			m_CenterZ.resize(paddedCount, 0.0f);
+			m_Radius.resize(paddedCount, -std::numeric_limits<float>::infinity());
+		}
+
+		setObject(index, center, radius);
+		return index;
+	}
+
+	void SdeCpuCuller::setObject(uint32_t index, const glm::vec3& center, float radius)
+	{
+		m_CenterX[index] = center.x;
+		m_CenterY[index] = center.y;
+		m_CenterZ[index] = center.z;
+		m_Radius[index] = radius;
+	}
+
+	void SdeCpuCuller::clear()
+	{
+		m_CenterX.clear();
+		m_CenterY.clear();
+		m_CenterZ.clear();
+		m_Radius.clear();
+		m_Count = 0;
+	}
+
+	void SdeCpuCuller::reserve(uint32_t count)
+	{
+		uint32_t paddedCount = roundUp(count, LANE_PADDING);
+		m_CenterX.reserve(paddedCount);
+		m_CenterY.reserve(paddedCount);
+		m_CenterZ.reserve(paddedCount);
+		m_Radius.reserve(paddedCount);
+	}
+
+	void SdeCpuCuller::cull(const SdeFrustum& frustum, std::vector<uint32_t>& visible, SdeJobSystem* jobSystem) const
+	{
+		SDE_TRACE_FUNCTION();
+
+		uint32_t paddedCount = static_cast<uint32_t>(m_Radius.size());
+		visible.resize(paddedCount);
+		if (paddedCount == 0) return;
+
+		uint32_t rangeCount = jobSystem ? jobSystem->getThreadCount() : 1;
+		rangeCount = std::max(1u, std::min(rangeCount, paddedCount / MIN_OBJECTS_PER_JOB));
+		if (rangeCount == 1) {
+			visible.resize(cullRange(frustum, 0, paddedCount, visible.data()));
+			return;
+		}
+
+		// Every range writes its indices at its own start, then the results are packed in order
+		uint32_t chunkSize = roundUp((paddedCount + rangeCount - 1) / rangeCount, LANE_PADDING);
+		std::vector<uint32_t> rangeCounts(rangeCount, 0);
+		SdeJobCounter counter;
+
+		for (uint32_t i = 1; i < rangeCount; i++) {
+			uint32_t begin = std::min(i * chunkSize, paddedCount);
+			uint32_t end = std::min(begin + chunkSize, paddedCount);
+			jobSystem->run([&, i, begin, end]() {
+				rangeCounts[i] = cullRange(frustum, begin, end, visible.data() + begin);
+			}, &counter);
+		}
+		rangeCounts[0] = cullRange(frustum, 0, std::min(chunkSize, paddedCount), visible.data());
+
+		jobSystem->wait(counter);
+
+		uint32_t visibleCount = rangeCounts[0];
+		for (uint32_t i = 1; i < rangeCount; i++) {
+			uint32_t begin = std::min(i * chunkSize, paddedCount);
+			std::memmove(visible.data() + visibleCount, visible.data() + begin, rangeCounts[i] * sizeof(uint32_t));
+			visibleCount += rangeCounts[i];
+		}
+		visible.resize(visibleCount);
+	}
+
+	const char* SdeCpuCuller::kernelName()
+	{
+	#if defined(SDE_CULL_AVX)
+		return "avx";
+	#elif defined(SDE_CULL_SSE)
+		return "sse";
+	#else
+		return "scalar";
+	#endif
+	}
+
+	uint32_t SdeCpuCuller::cullRange(const SdeFrustum& frustum, uint32_t begin, uint32_t end, uint32_t* out) const
+	{
+		const float* centerX = m_CenterX.data();
+		const float* centerY = m_CenterY.data();
+		const float* centerZ = m_CenterZ.data();
+		const float* radius = m_Radius.data();
+
+		// Indices are written unconditionally and only kept when the lane is visible
+		uint32_t count = 0;
+
+	#if defined(SDE_CULL_AVX)
+		__m256 planeX[SdeFrustum::PlaneCount], planeY[SdeFrustum::PlaneCount], planeZ[SdeFrustum::PlaneCount], planeW[SdeFrustum::PlaneCount];
+		for (int p = 0; p < SdeFrustum::PlaneCount; p++) {
+			planeX[p] = _mm256_set1_ps(frustum.planes[p].x);
+			planeY[p] = _mm256_set1_ps(frustum.planes[p].y);
+			planeZ[p] = _mm256_set1_ps(frustum.planes[p].z);
+			planeW[p] = _mm256_set1_ps(frustum.planes[p].w);
+		}
+
+		const __m256 zero = _mm256_setzero_ps();
+		for (uint32_t i = begin; i < end; i += 8) {
+			__m256 x = _mm256_load_ps(centerX + i);
+			__m256 y = _mm256_load_ps(centerY + i);
+			__m256 z = _mm256_load_ps(centerZ + i);
+			__m256 negRadius = _mm256_sub_ps(zero, _mm256_load_ps(radius + i));
+
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int p = 0; p < SdeFrustum::PlaneCount; p++) {
+				__m256 distance = _mm256_add_ps(
+					_mm256_add_ps(_mm256_mul_ps(planeX[p], x), _mm256_mul_ps(planeY[p], y)),
+					_mm256_add_ps(_mm256_mul_ps(planeZ[p], z), planeW[p]));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+			}
+
+			uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(inside));
+			for (uint32_t lane = 0; lane < 8; lane++) {
+				out[count] = i + lane;
+				count += (mask >> lane) & 1;
+			}
+		}
+	#elif defined(SDE_CULL_SSE)
+		__m128 planeX[SdeFrustum::PlaneCount], planeY[SdeFrustum::PlaneCount], planeZ[SdeFrustum::PlaneCount], planeW[SdeFrustum::PlaneCount];
+		for (int p = 0; p < SdeFrustum::PlaneCount; p++) {
+			planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+			planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+			planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+			planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+		}
+
+		const __m128 zero = _mm_setzero_ps();
+		for (uint32_t i = begin; i < end; i += 4) {
+			__m128 x = _mm_load_ps(centerX + i);
+			__m128 y = _mm_load_ps(centerY + i);
+			__m128 z = _mm_load_ps(centerZ + i);
+			__m128 negRadius = _mm_sub_ps(zero, _mm_load_ps(radius + i));
+
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int p = 0; p < SdeFrustum::PlaneCount; p++) {
+				__m128 distance = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)),
+					_mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p]));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+			}
+
+			uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(inside));
+			for (uint32_t lane = 0; lane < 4; lane++) {
+				out[count] = i + lane;
+				count += (mask >> lane) & 1;
+			}
+		}
+	#else
+		for (uint32_t i = begin; i < end; i++) {
+			bool inside = true;
+			for (const auto& plane : frustum.planes) {
+				inside &= plane.x * centerX[i] + plane.y * centerY[i] + plane.z * centerZ[i] + plane.w >= -radius[i];
+			}
+
+			out[count] = i;
+			count += inside ? 1 : 0;
+		}
+	#endif
+
+		return count;
+	}
+
+}
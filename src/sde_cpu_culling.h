@@ -0,0 +1,71 @@
+#pragma once
+
+#include "sde_frustum.h"
+#include "sde_job_system.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+namespace sde {
+
+	template<typename T, size_t Alignment>
+	struct SdeAlignedAllocator {
+		using value_type = T;
+
+		template<typename U>
+		struct rebind { using other = SdeAlignedAllocator<U, Alignment>; };
+
+		SdeAlignedAllocator() = default;
+		template<typename U>
+		SdeAlignedAllocator(const SdeAlignedAllocator<U, Alignment>&) {}
+
+		T* allocate(size_t count) { return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(Alignment))); }
+		void deallocate(T* pointer, size_t) { ::operator delete(pointer, std::align_val_t(Alignment)); }
+
+		template<typename U>
+		bool operator==(const SdeAlignedAllocator<U, Alignment>&) const { return true; }
+		template<typename U>
+		bool operator!=(const SdeAlignedAllocator<U, Alignment>&) const { return false; }
+	};
+
+	// World space bounding spheres in structure of arrays layout, culled 8 (AVX) or 4 (SSE) at a time.
+	// Arrays are padded to a multiple of LANE_PADDING so kernels never need a scalar tail.
+	class SdeCpuCuller {
+	public:
+		static constexpr size_t ALIGNMENT = 32;
+		static constexpr uint32_t LANE_PADDING = 8;
+		// Below this many objects per job the split costs more than it saves
+		static constexpr uint32_t MIN_OBJECTS_PER_JOB = 16384;
+
+		using FloatArray = std::vector<float, SdeAlignedAllocator<float, ALIGNMENT>>;
+
+		SdeCpuCuller() = default;
+
+		SdeCpuCuller(const SdeCpuCuller&) = delete;
+		SdeCpuCuller& operator=(const SdeCpuCuller&) = delete;
+
+		uint32_t addObject(const glm::vec3& center, float radius);
+		void setObject(uint32_t index, const glm::vec3& center, float radius);
+		void clear();
+		void reserve(uint32_t count);
+
+		// Writes the indices of every object touching the frustum, in ascending order.
+		// Large sets are split over jobSystem, null culls on the calling thread only.
+		void cull(const SdeFrustum& frustum, std::vector<uint32_t>& visible, SdeJobSystem* jobSystem = nullptr) const;
+
+		uint32_t size() const { return m_Count; }
+		// Name of the kernel compiled in, "avx", "sse" or "scalar"
+		static const char* kernelName();
+
+	private:
+		// Culls [begin, end), begin is a multiple of LANE_PADDING, returns the number of indices written
+		uint32_t cullRange(const SdeFrustum& frustum, uint32_t begin, uint32_t end, uint32_t* out) const;
+
+	private:
+		FloatArray m_CenterX, m_CenterY, m_CenterZ, m_Radius;
+		uint32_t m_Count = 0;
+	};
+
+}
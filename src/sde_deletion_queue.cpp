@@ -0,0 +1,131 @@
+#include "sde_deletion_queue.h"
+#include "sde_timeline.h"
+#include "sde_trace.h"
+
+namespace sde {
+
+	SdeDeletionQueue::SdeDeletionQueue(SdeTimeline& timeline) : m_Timeline(timeline)
+	{
+	}
+
+	SdeDeletionQueue::~SdeDeletionQueue()
+	{
+		flush();
+	}
+
+	void SdeDeletionQueue::push(std::function<void()> destroy)
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+
+		if (m_FrameOpen) {
+			m_FrameEntries.push_back(std::move(destroy));
+			return;
+		}
+
+		uint64_t timelineValue = m_Timeline.getLastSubmittedValue();
+		if (!m_Timeline.isComplete(timelineValue)) {
+			m_Entries.push_back({ timelineValue, std::move(destroy) });
+			return;
+		}
+
+		lock.unlock();
+		destroy();
+	}
+
+	void SdeDeletionQueue::push(uint64_t timelineValue, std::function<void()> destroy)
+	{
+		if (m_Timeline.isComplete(timelineValue)) {
+			destroy();
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Entries.push_back({ timelineValue, std::move(destroy) });
+	}
+
+	void SdeDeletionQueue::beginFrame()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_FrameOpen = true;
+	}
+
+	void SdeDeletionQueue::endFrame(uint64_t submitValue)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		for (auto& destroy : m_FrameEntries) {
+			m_Entries.push_back({ submitValue, std::move(destroy) });
+		}
+		m_FrameEntries.clear();
+		m_FrameOpen = false;
+	}
+
+	void SdeDeletionQueue::abortFrame()
+	{
+		// The frame's command buffer may or may not have reached the queue, both are covered
+		endFrame(m_Timeline.getLastSubmittedValue());
+	}
+
+	void SdeDeletionQueue::collect()
+	{
+		SDE_TRACE_FUNCTION();
+
+		uint64_t completed = m_Timeline.getCompletedValue();
+		std::vector<std::function<void()>> ready;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+
+			// Keeps the push order of what stays queued
+			size_t kept = 0;
+			for (auto& entry : m_Entries) {
+				if (entry.timelineValue <= completed) {
+					ready.push_back(std::move(entry.destroy));
+				}
+				else {
+					m_Entries[kept++] = std::move(entry);
+				}
+			}
+			m_Entries.resize(kept);
+		}
+
+		run(ready);
+	}
+
+	void SdeDeletionQueue::flush()
+	{
+		m_Timeline.waitIdle();
+
+		// Destroys may push again, those run right away now that nothing is pending
+		std::vector<std::function<void()>> ready;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			for (auto& entry : m_Entries) {
+				ready.push_back(std::move(entry.destroy));
+			}
+			for (auto& destroy : m_FrameEntries) {
+				ready.push_back(std::move(destroy));
+			}
+			m_Entries.clear();
+			m_FrameEntries.clear();
+			m_FrameOpen = false;
+		}
+
+		run(ready);
+	}
+
+	size_t SdeDeletionQueue::getPendingCount()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Entries.size() + m_FrameEntries.size();
+	}
+
+	void SdeDeletionQueue::run(std::vector<std::function<void()>>& destroys)
+	{
+		// Newest first, like destructors
+		for (auto it = destroys.rbegin(); it != destroys.rend(); ++it) {
+			(*it)();
+		}
+		destroys.clear();
+	}
+
+}
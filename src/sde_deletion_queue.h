@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace sde {
+
+	class SdeTimeline;
+
+	// Destroys GPU objects once the submits that may still read them completed, so freeing a
+	// resource never needs a waitIdle. Resource wrappers push their destroys here from their destructors.
+	// Pushes while SdeRenderer records a frame wait for that frame's submit, others only for the work
+	// submitted so far and run right away when it already completed.
+	class SdeDeletionQueue {
+	public:
+		SdeDeletionQueue(SdeTimeline& timeline);
+		// Runs everything still queued, after waiting for the GPU
+		~SdeDeletionQueue();
+
+		SdeDeletionQueue(const SdeDeletionQueue&) = delete;
+		SdeDeletionQueue& operator=(const SdeDeletionQueue&) = delete;
+
+		// Thread safe, destroy never runs under the queue's lock and may push again
+		void push(std::function<void()> destroy);
+		// For resources whose last use is known, runs once timelineValue completed
+		void push(uint64_t timelineValue, std::function<void()> destroy);
+
+		// Called by SdeRenderer around recording, pushes in between may still be recorded into the frame
+		void beginFrame();
+		void endFrame(uint64_t submitValue);
+		// Closes a frame that threw before endFrame, its pushes wait for the work submitted so far
+		void abortFrame();
+
+		// Runs the destroys whose work completed, SdeRenderer calls it every frame
+		void collect();
+		// Waits for the GPU and runs everything
+		void flush();
+
+		size_t getPendingCount();
+
+	private:
+		struct Entry {
+			uint64_t timelineValue;
+			std::function<void()> destroy;
+		};
+
+		static void run(std::vector<std::function<void()>>& destroys);
+
+	private:
+		SdeTimeline& m_Timeline;
+		std::mutex m_Mutex;
+
+		bool m_FrameOpen = false;
+		// Waiting for the submit value of the frame being recorded
+		std::vector<std::function<void()>> m_FrameEntries;
+		std::vector<Entry> m_Entries;
+	};
+
+}
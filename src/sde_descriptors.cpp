@@ -1,4 +1,5 @@
 #include "sde_descriptors.h"
+#include "sde_deletion_queue.h"
 
 namespace sde {
 
@@ -41,6 +42,15 @@ namespace sde {
 		m_DescriptorPool = m_Device.device().createDescriptorPoolUnique(createInfo);
 	}
 
+	SdeDescriptorPool::~SdeDescriptorPool()
+	{
+		vk::Device device = m_Device.device();
+		vk::DescriptorPool descriptorPool = m_DescriptorPool.release();
+		m_Device.deletionQueue().push([device, descriptorPool]() {
+			device.destroyDescriptorPool(descriptorPool);
+		});
+	}
+
 	vk::DescriptorSet SdeDescriptorPool::allocateDescriptor(const vk::DescriptorSetLayout descriptorSetLayout)
 	{
 		vk::DescriptorSetAllocateInfo allocInfo = {};
@@ -57,6 +67,11 @@ namespace sde {
 
 	}
 
+	void SdeDescriptorPool::resetPool()
+	{
+		m_Device.device().resetDescriptorPool(m_DescriptorPool.get());
+	}
+
 	// Descriptor Set Layout Builder
 
 	SdeDescriptorSetLayout::Builder& SdeDescriptorSetLayout::Builder::addBinding(uint32_t bindingId, vk::DescriptorType descriptorType, vk::ShaderStageFlags stageFlags, uint32_t count)
@@ -67,8 +67,12 @@ namespace sde {
 		// End Builder definitions
 
 		SdeDescriptorPool(SdeDevice& device, uint32_t maxSets, vk::Flags<vk::DescriptorPoolCreateFlagBits> flags, const std::vector<vk::DescriptorPoolSize>& poolSizes);
+		// Sets of the pool may still be bound by frames in flight, destroyed through the deletion queue
+		~SdeDescriptorPool();
 
 		vk::DescriptorSet SdeDescriptorPool::allocateDescriptor(const vk::DescriptorSetLayout descriptorSetLayout);
+		// Frees every set allocated from the pool at once
+		void resetPool();
 
 		SdeDescriptorPool(const SdeDescriptorPool&) = delete;
 		SdeDescriptorPool& operator=(const SdeDescriptorPool&) = delete;
@@ -1,4 +1,12 @@
 #include "sde_device.h"
+#include "sde_upload_manager.h"
+#include "sde_timeline.h"
+#include "sde_deletion_queue.h"
+#include "sde_trace.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 
 namespace sde {
 
@@ -40,7 +48,19 @@ namespace sde {
 		}
 	}
 
-	sde::SdeDevice::SdeDevice(SdeWindow& window) : m_SdeWindow(window)
+	sde::SdeDevice::SdeDevice(SdeWindow& window) : m_SdeWindow(&window)
+	{
+		init();
+	}
+
+	sde::SdeDevice::SdeDevice()
+	{
+		// No presentation, so the swapchain extension is not required
+		deviceExtensions.clear();
+		init();
+	}
+
+	void SdeDevice::init()
 	{
 		createInstance();
 		setupDebugMessenger();
@@ -49,10 +69,22 @@ namespace sde {
 		createLogicalDevice();
 		createCommandPool();
 		createAllocator();
+		m_Timeline = std::make_unique<SdeTimeline>(*this);
+		m_DeletionQueue = std::make_unique<SdeDeletionQueue>(*m_Timeline);
+		createUploadManager();
+		createPipelineCache();
 	}
 
 	sde::SdeDevice::~SdeDevice()
 	{
+		// The upload manager's staging buffers still go through the deletion queue
+		m_UploadManager.reset();
+		m_DeletionQueue.reset();
+		m_Timeline.reset();
+
+		savePipelineCache();
+		m_Device.get().destroyPipelineCache(m_PipelineCache);
+
 		m_Allocator.destroy();
 		m_Device.get().destroyCommandPool(m_CommandPool);
 
@@ -60,7 +92,9 @@ namespace sde {
 			DestroyDebugUtilsMessengerEXT(m_Instance.get(), m_DebugMessenger, nullptr);
 		}
 
-		m_Instance.get().destroySurfaceKHR(m_Surface);
+		if (m_Surface) {
+			m_Instance.get().destroySurfaceKHR(m_Surface);
+		}
 	}
 
 	vk::CommandBuffer SdeDevice::beginSingleTimeCommand()
@@ -86,25 +120,25 @@ namespace sde {
 		submitInfo.pCommandBuffers = &commandBuffer;
 
 		m_GraphicsQueue.submit(submitInfo);
-		m_GraphicsQueue.waitIdle();
+		{
+			SDE_TRACE_ZONE("WaitQueueIdle");
+			m_GraphicsQueue.waitIdle();
+		}
 
 		m_Device->freeCommandBuffers(m_CommandPool, commandBuffer);;
 	}
 
 	void SdeDevice::copyBuffer(vk::Buffer src, vk::Buffer dst, uint64_t size)
 	{
-		auto commandBuffer = beginSingleTimeCommand();
+		SDE_TRACE_FUNCTION();
 
-		vk::BufferCopy copyRegion = {};
-		copyRegion.size = size;
-
-		commandBuffer.copyBuffer(src, dst, 1, &copyRegion);
-		endSingleTimeCommand(commandBuffer);
+		m_UploadManager->wait(m_UploadManager->copyBuffer(src, dst, size));
 	}
 
 	void sde::SdeDevice::createInstance()
 	{
-		vk::ApplicationInfo appInfo(m_SdeWindow.getName().c_str(), 1, "No Engine", 1, VK_API_VERSION_1_1);
+		std::string appName = isHeadless() ? "Headless" : m_SdeWindow->getName();
+		vk::ApplicationInfo appInfo(appName.c_str(), 1, "No Engine", 1, VK_API_VERSION_1_1);
 
 		auto glfwExtensions = getRequiredExtensions();
 
@@ -139,7 +173,9 @@ namespace sde {
 
 	void SdeDevice::createSurface()
 	{
-		m_Surface = m_SdeWindow.createSurface(m_Instance.get());
+		if (isHeadless()) return;
+
+		m_Surface = m_SdeWindow->createSurface(m_Instance.get());
 	}
 
 	void sde::SdeDevice::pickPhysicalDevice()
@@ -170,7 +206,10 @@ namespace sde {
 	{
 		auto queueIndices = findQueueFamilies(m_PhysicalDevice);
 		std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
-		std::set<uint32_t> uniqueQueueFamilies = { queueIndices.graphicsFamily.value(), queueIndices.presentFamily.value() };
+		std::set<uint32_t> uniqueQueueFamilies = { queueIndices.graphicsFamily.value() };
+		if (queueIndices.presentFamily.has_value()) {
+			uniqueQueueFamilies.insert(queueIndices.presentFamily.value());
+		}
 
 		float queuePriority = 0.0f;
 		for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -182,7 +221,13 @@ namespace sde {
 			});
 		}
 
+		// Optional features, callers check getEnabledFeatures() and fall back
+		auto supportedFeatures = m_PhysicalDevice.getFeatures();
 		auto deviceFeatures = vk::PhysicalDeviceFeatures();
+		deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+		deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+		m_EnabledFeatures = deviceFeatures;
+
 		auto createInfo = vk::DeviceCreateInfo(
 			vk::DeviceCreateFlags(),
 			static_cast<uint32_t>(queueCreateInfos.size()),
@@ -191,18 +236,55 @@ namespace sde {
 
 		createInfo.pEnabledFeatures = &deviceFeatures;
 
-		createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-		createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+		// Optional extensions
+		std::vector<const char*> enabledExtensions = deviceExtensions;
+		bool drawIndirectCount = false;
+		bool timelineSemaphore = false;
+		for (const auto& extension : m_PhysicalDevice.enumerateDeviceExtensionProperties()) {
+			if (std::string(extension.extensionName.data()) == VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME) {
+				enabledExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+				drawIndirectCount = true;
+			}
+			if (std::string(extension.extensionName.data()) == VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) {
+				timelineSemaphore = true;
+			}
+		}
+
+		// The extension alone is not enough, the feature has to be enabled too
+		vk::PhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures = {};
+		if (timelineSemaphore) {
+			auto features = m_PhysicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceTimelineSemaphoreFeaturesKHR>();
+			timelineSemaphore = features.get<vk::PhysicalDeviceTimelineSemaphoreFeaturesKHR>().timelineSemaphore;
+		}
+		if (timelineSemaphore) {
+			enabledExtensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+			timelineFeatures.timelineSemaphore = VK_TRUE;
+			createInfo.pNext = &timelineFeatures;
+		}
+
+		createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+		createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
 		if (enableValidationLayers) {
-			createInfo.enabledLayerCount = static_cast<uint32_t>(deviceExtensions.size());
+			createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
 			createInfo.ppEnabledLayerNames = validationLayers.data();
 		}
 
 		m_Device = m_PhysicalDevice.createDeviceUnique(createInfo);
 
+		if (drawIndirectCount) {
+			m_DrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+				m_Device->getProcAddr("vkCmdDrawIndexedIndirectCountKHR"));
+		}
+		if (timelineSemaphore) {
+			m_WaitSemaphores = reinterpret_cast<PFN_vkWaitSemaphoresKHR>(m_Device->getProcAddr("vkWaitSemaphoresKHR"));
+			m_GetSemaphoreCounterValue = reinterpret_cast<PFN_vkGetSemaphoreCounterValueKHR>(m_Device->getProcAddr("vkGetSemaphoreCounterValueKHR"));
+		}
+
 		m_GraphicsQueue = m_Device.get().getQueue(queueIndices.graphicsFamily.value(), 0);
-		m_PresentQueue = m_Device.get().getQueue(queueIndices.presentFamily.value(), 0);
+		if (queueIndices.presentFamily.has_value()) {
+			m_PresentQueue = m_Device.get().getQueue(queueIndices.presentFamily.value(), 0);
+		}
 	}
 
 	void SdeDevice::createCommandPool()
@@ -233,12 +315,94 @@ namespace sde {
 		m_Allocator = vma::createAllocator(allocatorCreateInfo);
 	}
 
+	void SdeDevice::createPipelineCache()
+	{
+		SDE_TRACE_FUNCTION();
+
+		// 1. Read the previous cache, a missing or stale file just means a cold start
+		std::vector<char> data;
+		std::ifstream file(PIPELINE_CACHE_PATH, std::ios::ate | std::ios::binary);
+		if (file.is_open()) {
+			data.resize(static_cast<size_t>(file.tellg()));
+			file.seekg(0);
+			file.read(data.data(), data.size());
+
+			if (!file || !isPipelineCacheCompatible(data)) {
+				std::cout << "Ignoring incompatible pipeline cache: " << PIPELINE_CACHE_PATH << std::endl;
+				data.clear();
+			}
+		}
+
+		// 2. Create the cache, seeded with the file contents
+		vk::PipelineCacheCreateInfo createInfo = {};
+		createInfo.initialDataSize = data.size();
+		createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+		m_PipelineCache = m_Device->createPipelineCache(createInfo);
+	}
+
+	bool SdeDevice::isPipelineCacheCompatible(const std::vector<char>& data)
+	{
+		// Header layout of VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+		constexpr size_t headerSize = 16 + VK_UUID_SIZE;
+		if (data.size() < headerSize) return false;
+
+		uint32_t header[4];
+		memcpy(header, data.data(), sizeof(header));
+
+		auto properties = m_PhysicalDevice.getProperties();
+		return header[0] >= headerSize
+			&& header[1] == static_cast<uint32_t>(vk::PipelineCacheHeaderVersion::eOne)
+			&& header[2] == properties.vendorID
+			&& header[3] == properties.deviceID
+			&& memcmp(data.data() + 16, properties.pipelineCacheUUID.data(), VK_UUID_SIZE) == 0;
+	}
+
+	void SdeDevice::savePipelineCache()
+	{
+		SDE_TRACE_FUNCTION();
+
+		auto data = m_Device->getPipelineCacheData(m_PipelineCache);
+		if (data.empty()) return;
+
+		// Write next to the cache and rename over it, a crash mid write never leaves a truncated cache
+		std::string tempPath = std::string(PIPELINE_CACHE_PATH) + ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open()) {
+				std::cout << "Failed to write pipeline cache: " << tempPath << std::endl;
+				return;
+			}
+
+			file.write(reinterpret_cast<const char*>(data.data()), data.size());
+			if (!file) {
+				std::cout << "Failed to write pipeline cache: " << tempPath << std::endl;
+				return;
+			}
+		}
+
+		std::error_code error;
+		std::filesystem::rename(tempPath, PIPELINE_CACHE_PATH, error);
+		if (error) {
+			std::cout << "Failed to replace pipeline cache: " << error.message() << std::endl;
+			std::filesystem::remove(tempPath, error);
+		}
+	}
+
+	void SdeDevice::createUploadManager()
+	{
+		m_UploadManager = std::make_unique<SdeUploadManager>(*this);
+	}
+
 	std::vector<const char*> SdeDevice::getRequiredExtensions()
 	{
-		uint32_t glfwExtensionCount = 0;
-		const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+		std::vector<const char*> extensions;
 
-		std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+		if (!isHeadless()) {
+			uint32_t glfwExtensionCount = 0;
+			const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+			extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+		}
 
 		if (enableValidationLayers)
 		{
@@ -260,6 +424,10 @@ namespace sde {
 		auto indices = findQueueFamilies(device);
 		bool extensionsSupported = checkDeviceExtensionSupport(device);
 
+		if (isHeadless()) {
+			return indices.isComplete(true) && extensionsSupported;
+		}
+
 		bool swapChainAdequate = false;
 		if (extensionsSupported) {
 			auto swapChainSupport = querySwapChainSupport(device);
@@ -278,9 +446,9 @@ namespace sde {
 		for (const auto& queueFamily : queueFamilyProperties) {
 			if (queueFamily.queueFlags & vk::QueueFlagBits::eGraphics)
 				indices.graphicsFamily = i;
-			if (queueFamily.queueCount > 0 && physicalDevice.getSurfaceSupportKHR(i, m_Surface))
+			if (!isHeadless() && queueFamily.queueCount > 0 && physicalDevice.getSurfaceSupportKHR(i, m_Surface))
 				indices.presentFamily = i;
-			if (indices.isComplete())
+			if (indices.isComplete(isHeadless()))
 				break;
 			i++;
 		}
@@ -9,9 +9,14 @@
 #include <optional>
 #include <vulkan/vulkan.hpp>
 #include <iostream>
+#include <memory>
 
 namespace sde {
 
+	class SdeUploadManager;
+	class SdeTimeline;
+	class SdeDeletionQueue;
+
 	struct SwapChainSupportDetails {
 		vk::SurfaceCapabilitiesKHR capabilities;
 		std::vector<vk::SurfaceFormatKHR> formats;
@@ -22,14 +27,17 @@ namespace sde {
 		std::optional<uint32_t> graphicsFamily;
 		std::optional<uint32_t> presentFamily;
 
-		bool isComplete() {
-			return graphicsFamily.has_value() && presentFamily.has_value();
+		bool isComplete(bool headless = false) {
+			return graphicsFamily.has_value() && (headless || presentFamily.has_value());
 		}
 	};
 
 
 	class SdeDevice {
 	public:
+		// Relative to the working directory
+		static constexpr const char* PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+
 	#ifdef NDEBUG
 		const bool enableValidationLayers = false;
 	#else
@@ -37,6 +45,8 @@ namespace sde {
 	#endif
 
 		SdeDevice(SdeWindow& window);
+		// Headless device: no surface, no swapchain extension, any graphics queue
+		SdeDevice();
 		~SdeDevice();
 
 		// Not copyable or movable
@@ -46,21 +56,40 @@ namespace sde {
 		SdeDevice& operator=(SdeDevice&&) = delete;
 
 	public:
+		vk::PhysicalDevice physicalDevice() { return m_PhysicalDevice; }
+		vk::PhysicalDeviceProperties getProperties() { return m_PhysicalDevice.getProperties(); }
+		const vk::PhysicalDeviceFeatures& getEnabledFeatures() const { return m_EnabledFeatures; }
+		// VK_KHR_draw_indirect_count, null when the extension is not available
+		PFN_vkCmdDrawIndexedIndirectCountKHR drawIndexedIndirectCountFn() const { return m_DrawIndexedIndirectCount; }
+		// VK_KHR_timeline_semaphore, SdeTimeline falls back to fences without it
+		bool supportsTimelineSemaphores() const { return m_WaitSemaphores != nullptr; }
+		PFN_vkWaitSemaphoresKHR waitSemaphoresFn() const { return m_WaitSemaphores; }
+		PFN_vkGetSemaphoreCounterValueKHR getSemaphoreCounterValueFn() const { return m_GetSemaphoreCounterValue; }
 		vk::Queue graphicsQueue() { return m_GraphicsQueue; }
 		vk::Queue presentQueue() { return m_PresentQueue; }
 		vk::Device device() { return m_Device.get(); }
 		vk::SurfaceKHR surface() { return m_Surface; }
 		vk::CommandPool commandPool() { return m_CommandPool; }
+		// Pass to every pipeline creation, persisted to PIPELINE_CACHE_PATH on destruction
+		vk::PipelineCache pipelineCache() { return m_PipelineCache; }
 		vma::Allocator getAllocator() { return m_Allocator; }
+		SdeUploadManager& uploadManager() { return *m_UploadManager; }
+		// Every graphics queue submission goes through it
+		SdeTimeline& timeline() { return *m_Timeline; }
+		// Resource wrappers destroy through it instead of immediately
+		SdeDeletionQueue& deletionQueue() { return *m_DeletionQueue; }
+		bool isHeadless() const { return m_SdeWindow == nullptr; }
 
 		vk::CommandBuffer beginSingleTimeCommand();
 		void endSingleTimeCommand(vk::CommandBuffer commandBuffer);
+		// Blocking, prefer recording through uploadManager() and polling its handle
 		void copyBuffer(vk::Buffer src, vk::Buffer dst, uint64_t size);
 
 		QueueFamilyIndices findPhysicalQueueFamilies() { return findQueueFamilies(m_PhysicalDevice); }
 		SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(m_PhysicalDevice); }
 
 	private:
+		void init();
 		void createInstance();
 		void setupDebugMessenger();
 		void createSurface();
@@ -68,6 +97,10 @@ namespace sde {
 		void createLogicalDevice();
 		void createCommandPool();
 		void createAllocator();
+		void createUploadManager();
+		void createPipelineCache();
+		void savePipelineCache();
+		bool isPipelineCacheCompatible(const std::vector<char>& data);
 
 		// Helper functions
 		std::vector<const char*> getRequiredExtensions();
@@ -81,18 +114,26 @@ namespace sde {
 	private:
 		vk::UniqueInstance m_Instance;
 		vk::PhysicalDevice m_PhysicalDevice;
+		vk::PhysicalDeviceFeatures m_EnabledFeatures;
+		PFN_vkCmdDrawIndexedIndirectCountKHR m_DrawIndexedIndirectCount = nullptr;
+		PFN_vkWaitSemaphoresKHR m_WaitSemaphores = nullptr;
+		PFN_vkGetSemaphoreCounterValueKHR m_GetSemaphoreCounterValue = nullptr;
 		vk::UniqueDevice m_Device;
 		vk::SurfaceKHR m_Surface;
 		vk::Queue m_GraphicsQueue, m_PresentQueue;
 		vk::CommandPool m_CommandPool;
+		vk::PipelineCache m_PipelineCache;
 
 		vma::Allocator m_Allocator;
+		std::unique_ptr<SdeTimeline> m_Timeline;
+		std::unique_ptr<SdeDeletionQueue> m_DeletionQueue;
+		std::unique_ptr<SdeUploadManager> m_UploadManager;
 
 		VkDebugUtilsMessengerEXT m_DebugMessenger;
 
-		SdeWindow& m_SdeWindow;
+		SdeWindow* m_SdeWindow = nullptr;
 
 		const std::vector<const char*> validationLayers = { "VK_LAYER_KHRONOS_validation" };
-		const std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+		std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
 	};
 }
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include "sde_frame_context.h"
+#include "sde_trace.h"
+
+namespace sde {
+
+	SdeFrameContext::SdeFrameContext(SdeDevice& device) : m_Device(device)
+	{
+		// Transient: the pool is reset as a whole every frame, its buffers are never reset one by one
+		vk::CommandPoolCreateInfo poolInfo = {};
+		poolInfo.flags = vk::CommandPoolCreateFlagBits::eTransient;
+		poolInfo.queueFamilyIndex = m_Device.findPhysicalQueueFamilies().graphicsFamily.value();
+		m_CommandPool = m_Device.device().createCommandPool(poolInfo);
+
+		vk::CommandBufferAllocateInfo allocInfo = {};
+		allocInfo.commandPool = m_CommandPool;
+		allocInfo.level = vk::CommandBufferLevel::ePrimary;
+		allocInfo.commandBufferCount = 1;
+
+		try {
+			m_CommandBuffer = m_Device.device().allocateCommandBuffers(allocInfo)[0];
+		}
+		catch (vk::SystemError err) {
+			throw std::runtime_error("Failed to allocate command buffers");
+		}
+
+		m_DescriptorPool = SdeDescriptorPool::Builder(m_Device)
+			.setMaxSets(MAX_TRANSIENT_SETS)
+			.addPoolSize(vk::DescriptorType::eUniformBuffer, MAX_TRANSIENT_SETS)
+			.addPoolSize(vk::DescriptorType::eUniformBufferDynamic, MAX_TRANSIENT_SETS)
+			.addPoolSize(vk::DescriptorType::eStorageBuffer, MAX_TRANSIENT_SETS)
+			.addPoolSize(vk::DescriptorType::eCombinedImageSampler, MAX_TRANSIENT_SETS)
+			.build();
+	}
+
+	SdeFrameContext::~SdeFrameContext()
+	{
+		// Destroying the pool frees the command buffer
+		m_Device.device().destroyCommandPool(m_CommandPool);
+	}
+
+	void SdeFrameContext::reset()
+	{
+		SDE_TRACE_FUNCTION();
+
+		m_Device.device().resetCommandPool(m_CommandPool);
+		m_DescriptorPool->resetPool();
+
+		// Whatever was not reused since the last reset goes, this frame's buffers become reusable
+		m_FreeBuffers = std::move(m_UsedBuffers);
+		m_UsedBuffers.clear();
+	}
+
+	SdeBuffer& SdeFrameContext::createTransientBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vma::AllocationCreateFlags allocationFlags)
+	{
+		// Smallest free buffer that fits
+		auto best = m_FreeBuffers.end();
+		for (auto it = m_FreeBuffers.begin(); it != m_FreeBuffers.end(); ++it) {
+			if (it->usage != usage || it->allocationFlags != allocationFlags || it->size < size) continue;
+			if (best == m_FreeBuffers.end() || it->size < best->size) best = it;
+		}
+
+		if (best != m_FreeBuffers.end()) {
+			m_UsedBuffers.push_back(std::move(*best));
+			m_FreeBuffers.erase(best);
+		}
+		else {
+			TransientBuffer transient = {};
+			transient.buffer = std::make_unique<SdeBuffer>(m_Device, size, usage, allocationFlags);
+			transient.size = size;
+			transient.usage = usage;
+			transient.allocationFlags = allocationFlags;
+			m_UsedBuffers.push_back(std::move(transient));
+		}
+
+		return *m_UsedBuffers.back().buffer;
+	}
+
+}
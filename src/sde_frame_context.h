@@ -0,0 +1,62 @@
+#pragma once
+
+#include "sde_device.h"
+#include "sde_buffer.h"
+#include "sde_descriptors.h"
+
+#include <vulkan/vulkan.hpp>
+#include <memory>
+#include <vector>
+
+namespace sde {
+
+	// Resources owned by one frame in flight. Everything is recycled at once by reset() when the
+	// frame retired, so none of it needs per object tracking or locks.
+	class SdeFrameContext {
+	public:
+		static constexpr uint32_t MAX_TRANSIENT_SETS = 256;
+
+		SdeFrameContext(SdeDevice& device);
+		// The device must be idle
+		~SdeFrameContext();
+
+		SdeFrameContext(const SdeFrameContext&) = delete;
+		SdeFrameContext& operator=(const SdeFrameContext&) = delete;
+
+		// The frame's last submit must have completed
+		void reset();
+
+		// Primary command buffer of the frame, begun with eOneTimeSubmit
+		vk::CommandBuffer getCommandBuffer() const { return m_CommandBuffer; }
+
+		// Descriptor set valid until the frame is reset
+		vk::DescriptorSet allocateDescriptorSet(vk::DescriptorSetLayout layout) { return m_DescriptorPool->allocateDescriptor(layout); }
+		SdeDescriptorPool& descriptorPool() { return *m_DescriptorPool; }
+
+		// Buffer valid until the frame is reset. Buffers unused for a whole frame are released,
+		// the others are handed out again to requests with the same usage and a size that fits.
+		SdeBuffer& createTransientBuffer(
+			vk::DeviceSize size,
+			vk::BufferUsageFlags usage,
+			vma::AllocationCreateFlags allocationFlags = vma::AllocationCreateFlagBits::eMapped | vma::AllocationCreateFlagBits::eHostAccessSequentialWrite);
+
+	private:
+		struct TransientBuffer {
+			std::unique_ptr<SdeBuffer> buffer;
+			vk::DeviceSize size;
+			vk::BufferUsageFlags usage;
+			vma::AllocationCreateFlags allocationFlags;
+		};
+
+	private:
+		SdeDevice& m_Device;
+
+		vk::CommandPool m_CommandPool;
+		vk::CommandBuffer m_CommandBuffer;
+		std::unique_ptr<SdeDescriptorPool> m_DescriptorPool;
+
+		std::vector<TransientBuffer> m_UsedBuffers;
+		std::vector<TransientBuffer> m_FreeBuffers;
+	};
+
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <array>
+
+namespace sde {
+
+	// Six planes (xyz = normal pointing inside, w = distance) extracted from a view projection matrix
+	struct SdeFrustum {
+		enum Plane { Left = 0, Right, Bottom, Top, Near, Far, PlaneCount };
+
+		std::array<glm::vec4, PlaneCount> planes = {};
+
+		// Gribb/Hartmann extraction, clip space depth is [0, 1]
+		static SdeFrustum fromMatrix(const glm::mat4& viewProjection)
+		{
+			glm::vec4 row0 = glm::vec4(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+			glm::vec4 row1 = glm::vec4(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+			glm::vec4 row2 = glm::vec4(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+			glm::vec4 row3 = glm::vec4(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+			SdeFrustum frustum;
+			frustum.planes[Left] = row3 + row0;
+			frustum.planes[Right] = row3 - row0;
+			frustum.planes[Bottom] = row3 + row1;
+			frustum.planes[Top] = row3 - row1;
+			frustum.planes[Near] = row2;
+			frustum.planes[Far] = row3 - row2;
+
+			for (auto& plane : frustum.planes) {
+				plane /= glm::length(glm::vec3(plane));
+			}
+
+			return frustum;
+		}
+
+		bool intersectsSphere(const glm::vec3& center, float radius) const
+		{
+			for (const auto& plane : planes) {
+				if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+					return false;
+				}
+			}
+			return true;
+		}
+	};
+
+}
@@ -0,0 +1,168 @@
+#include "sde_gpu_profiler.h"
+#include "sde_deletion_queue.h"
+
+#include <algorithm>
+
+namespace sde {
+
+	SdeGpuProfiler::SdeGpuProfiler(SdeDevice& device, uint32_t framesInFlight) : m_Device(device)
+	{
+		auto properties = m_Device.getProperties();
+		auto queueFamilies = m_Device.physicalDevice().getQueueFamilyProperties();
+		uint32_t validBits = queueFamilies[m_Device.findPhysicalQueueFamilies().graphicsFamily.value()].timestampValidBits;
+
+		m_Supported = validBits > 0 && properties.limits.timestampPeriod > 0.0f;
+		m_TimestampPeriod = properties.limits.timestampPeriod;
+		m_TimestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+
+		if (!m_Supported) {
+			std::cout << "GPU profiler: timestamps not supported on the graphics queue\n";
+			return;
+		}
+
+		vk::QueryPoolCreateInfo createInfo = {};
+		createInfo.queryType = vk::QueryType::eTimestamp;
+		createInfo.queryCount = MAX_SCOPES * 2;
+
+		m_Frames.resize(framesInFlight);
+		for (auto& frame : m_Frames) {
+			frame.queryPool = m_Device.device().createQueryPool(createInfo);
+			frame.scopeNames.reserve(MAX_SCOPES);
+		}
+	}
+
+	SdeGpuProfiler::~SdeGpuProfiler()
+	{
+		vk::Device device = m_Device.device();
+		std::vector<vk::QueryPool> queryPools;
+		for (auto& frame : m_Frames) {
+			queryPools.push_back(frame.queryPool);
+		}
+
+		m_Device.deletionQueue().push([device, queryPools]() {
+			for (auto queryPool : queryPools) {
+				device.destroyQueryPool(queryPool);
+			}
+		});
+	}
+
+	void SdeGpuProfiler::beginFrame(vk::CommandBuffer commandBuffer, uint32_t frameIndex)
+	{
+		if (!m_Supported) return;
+
+		m_CurrentFrame = frameIndex;
+		m_FreshSamples = collect(frameIndex);
+
+		auto& frame = m_Frames[frameIndex];
+		frame.scopeNames.clear();
+		frame.pending = true;
+
+		commandBuffer.resetQueryPool(frame.queryPool, 0, MAX_SCOPES * 2);
+	}
+
+	uint32_t SdeGpuProfiler::beginScope(vk::CommandBuffer commandBuffer, const std::string& name)
+	{
+		if (!m_Supported) return INVALID_SCOPE;
+
+		auto& frame = m_Frames[m_CurrentFrame];
+		if (frame.scopeNames.size() >= MAX_SCOPES) return INVALID_SCOPE;
+
+		uint32_t scopeId = static_cast<uint32_t>(frame.scopeNames.size());
+		frame.scopeNames.push_back(name);
+
+		commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, frame.queryPool, scopeId * 2);
+		return scopeId;
+	}
+
+	void SdeGpuProfiler::endScope(vk::CommandBuffer commandBuffer, uint32_t scopeId)
+	{
+		if (!m_Supported || scopeId == INVALID_SCOPE) return;
+
+		auto& frame = m_Frames[m_CurrentFrame];
+		commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, frame.queryPool, scopeId * 2 + 1);
+	}
+
+	bool SdeGpuProfiler::getScopeStats(const std::string& name, SdeGpuScopeStats& stats) const
+	{
+		auto it = m_History.find(name);
+		if (it == m_History.end() || it->second.count == 0) return false;
+
+		const auto& history = it->second;
+
+		stats = {};
+		stats.sampleCount = history.count;
+		stats.minMs = history.samples[0];
+		stats.maxMs = history.samples[0];
+		stats.lastMs = history.samples[(history.next + HISTORY_SIZE - 1) % HISTORY_SIZE];
+
+		float total = 0.0f;
+		for (uint32_t i = 0; i < history.count; i++) {
+			float sample = history.samples[i];
+			stats.minMs = std::min(stats.minMs, sample);
+			stats.maxMs = std::max(stats.maxMs, sample);
+			total += sample;
+		}
+		stats.avgMs = total / static_cast<float>(history.count);
+
+		return true;
+	}
+
+	std::vector<std::pair<std::string, SdeGpuScopeStats>> SdeGpuProfiler::getAllScopeStats() const
+	{
+		std::vector<std::pair<std::string, SdeGpuScopeStats>> result;
+		result.reserve(m_History.size());
+
+		for (const auto& [name, history] : m_History) {
+			SdeGpuScopeStats stats;
+			if (getScopeStats(name, stats)) {
+				result.push_back({ name, stats });
+			}
+		}
+
+		return result;
+	}
+
+	bool SdeGpuProfiler::collect(uint32_t frameIndex)
+	{
+		auto& frame = m_Frames[frameIndex];
+		if (!frame.pending || frame.scopeNames.empty()) return false;
+
+		frame.pending = false;
+
+		uint32_t queryCount = static_cast<uint32_t>(frame.scopeNames.size()) * 2;
+		std::array<uint64_t, MAX_SCOPES * 2> timestamps = {};
+
+		// No wait flag: the frame fence already signaled, so results are available
+		auto result = m_Device.device().getQueryPoolResults(
+			frame.queryPool,
+			0,
+			queryCount,
+			queryCount * sizeof(uint64_t),
+			timestamps.data(),
+			sizeof(uint64_t),
+			vk::QueryResultFlagBits::e64
+		);
+
+		if (result != vk::Result::eSuccess) return false;
+
+		for (uint32_t i = 0; i < frame.scopeNames.size(); i++) {
+			uint64_t begin = timestamps[i * 2] & m_TimestampMask;
+			uint64_t end = timestamps[i * 2 + 1] & m_TimestampMask;
+			if (end < begin) continue;
+
+			float ms = static_cast<float>(static_cast<double>(end - begin) * m_TimestampPeriod / 1000000.0);
+			addSample(frame.scopeNames[i], ms);
+		}
+
+		return true;
+	}
+
+	void SdeGpuProfiler::addSample(const std::string& name, float ms)
+	{
+		auto& history = m_History[name];
+		history.samples[history.next] = ms;
+		history.next = (history.next + 1) % HISTORY_SIZE;
+		history.count = std::min(history.count + 1, HISTORY_SIZE);
+	}
+
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "sde_device.h"
+
+#include <vulkan/vulkan.hpp>
+#include <array>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace sde {
+
+	struct SdeGpuScopeStats {
+		float minMs = 0.0f;
+		float avgMs = 0.0f;
+		float maxMs = 0.0f;
+		float lastMs = 0.0f;
+		uint32_t sampleCount = 0;
+	};
+
+	class SdeGpuProfiler {
+	public:
+		static constexpr uint32_t MAX_SCOPES = 64;    // Per frame
+		static constexpr uint32_t HISTORY_SIZE = 128; // Frames kept per scope
+		static constexpr uint32_t INVALID_SCOPE = ~0u;
+
+		SdeGpuProfiler(SdeDevice& device, uint32_t framesInFlight);
+		~SdeGpuProfiler();
+
+		SdeGpuProfiler(const SdeGpuProfiler&) = delete;
+		SdeGpuProfiler& operator=(const SdeGpuProfiler&) = delete;
+
+		// Must be called right after the frame's fence has signaled, before any scope is opened.
+		// Reads back the previous use of this frame slot and resets its queries.
+		void beginFrame(vk::CommandBuffer commandBuffer, uint32_t frameIndex);
+
+		uint32_t beginScope(vk::CommandBuffer commandBuffer, const std::string& name);
+		void endScope(vk::CommandBuffer commandBuffer, uint32_t scopeId);
+
+		bool isSupported() const { return m_Supported; }
+		// True when the last beginFrame read back the timestamps of an older frame
+		bool hasFreshSamples() const { return m_FreshSamples; }
+		bool getScopeStats(const std::string& name, SdeGpuScopeStats& stats) const;
+		std::vector<std::pair<std::string, SdeGpuScopeStats>> getAllScopeStats() const;
+
+	private:
+		// Returns false when the slot held no finished frame or its results were not available
+		bool collect(uint32_t frameIndex);
+		void addSample(const std::string& name, float ms);
+
+		struct FrameQueries {
+			vk::QueryPool queryPool;
+			std::vector<std::string> scopeNames;
+			bool pending = false;
+		};
+
+		struct ScopeHistory {
+			std::array<float, HISTORY_SIZE> samples = {};
+			uint32_t count = 0;
+			uint32_t next = 0;
+		};
+
+	private:
+		SdeDevice& m_Device;
+
+		bool m_Supported = false;
+		float m_TimestampPeriod = 1.0f; // Nanoseconds per tick
+		uint64_t m_TimestampMask = ~0ull;
+
+		uint32_t m_CurrentFrame = 0;
+		bool m_FreshSamples = false;
+		std::vector<FrameQueries> m_Frames;
+		std::unordered_map<std::string, ScopeHistory> m_History;
+	};
+
+	// Opens a scope on construction and closes it when leaving the C++ scope
+	class SdeGpuScope {
+	public:
+		SdeGpuScope(SdeGpuProfiler& profiler, vk::CommandBuffer commandBuffer, const std::string& name)
+			: m_Profiler(profiler), m_CommandBuffer(commandBuffer), m_ScopeId(profiler.beginScope(commandBuffer, name)) {}
+		~SdeGpuScope() { m_Profiler.endScope(m_CommandBuffer, m_ScopeId); }
+
+		SdeGpuScope(const SdeGpuScope&) = delete;
+		SdeGpuScope& operator=(const SdeGpuScope&) = delete;
+
+	private:
+		SdeGpuProfiler& m_Profiler;
+		vk::CommandBuffer m_CommandBuffer;
+		uint32_t m_ScopeId;
+	};
+
+}
@@ -0,0 +1,263 @@
+#include "sde_indirect_draw.h"
+#include "sde_trace.h"
+
+#include <algorithm>
+
+namespace sde {
+
+	SdeIndirectDrawList::SdeIndirectDrawList(SdeDevice& device, SdeMeshPool& meshPool, uint32_t maxDraws)
+		: m_Device(device), m_MeshPool(meshPool), m_MaxDraws(maxDraws)
+	{
+		if (m_Device.getEnabledFeatures().multiDrawIndirect) {
+			m_MaxDraws = std::min(m_MaxDraws, m_Device.getProperties().limits.maxDrawIndirectCount);
+		}
+
+		m_DescriptorSetLayout = SdeDescriptorSetLayout::Builder(m_Device)
+			.addBinding(0, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eVertex)
+			.build();
+
+		m_DescriptorPool = SdeDescriptorPool::Builder(m_Device)
+			.setMaxSets(SdeSwapChain::MAX_FRAMES_IN_FLIGHT)
+			.addPoolSize(vk::DescriptorType::eStorageBuffer, SdeSwapChain::MAX_FRAMES_IN_FLIGHT)
+			.build();
+
+		// Written by the CPU every frame, read straight from host visible memory by the GPU
+		auto allocationFlags = vma::AllocationCreateFlagBits::eMapped | vma::AllocationCreateFlagBits::eHostAccessSequentialWrite;
+
+		m_Frames.resize(SdeSwapChain::MAX_FRAMES_IN_FLIGHT);
+		for (auto& frame : m_Frames) {
+			frame.commandBuffer = std::make_unique<SdeBuffer>(m_Device,
+				sizeof(vk::DrawIndexedIndirectCommand) * m_MaxDraws,
+				vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eStorageBuffer,
+				allocationFlags);
+
+			frame.objectBuffer = std::make_unique<SdeBuffer>(m_Device,
+				sizeof(SdeObjectData) * m_MaxDraws,
+				vk::BufferUsageFlagBits::eStorageBuffer,
+				allocationFlags);
+
+			vk::DescriptorBufferInfo bufferInfo = {};
+			bufferInfo.buffer = frame.objectBuffer->getBuffer();
+			bufferInfo.offset = 0;
+			bufferInfo.range = VK_WHOLE_SIZE;
+
+			frame.descriptorSet = SdeDescriptorWriter(*m_DescriptorSetLayout, *m_DescriptorPool)
+				.writeBuffer(0, &bufferInfo)
+				.build();
+		}
+	}
+
+	SdeIndirectDrawList::~SdeIndirectDrawList()
+	{
+		m_CullPipeline.reset();
+		if (m_CullPipelineLayout) {
+			m_Device.device().destroyPipelineLayout(m_CullPipelineLayout);
+		}
+	}
+
+	bool SdeIndirectDrawList::enableGpuCulling(SdeShaderCode cullShader)
+	{
+		if (isGpuCullingEnabled()) return true;
+
+		// Compacted draws keep their object index in firstInstance
+		if (!m_Device.getEnabledFeatures().drawIndirectFirstInstance) {
+			std::cout << "Indirect draw list: drawIndirectFirstInstance not supported, GPU culling disabled\n";
+			return false;
+		}
+
+		// 1. Set layout: input commands, objects, visible commands, draw count
+		m_CullSetLayout = SdeDescriptorSetLayout::Builder(m_Device)
+			.addBinding(0, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+			.addBinding(1, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+			.addBinding(2, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+			.addBinding(3, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+			.build();
+
+		m_CullPool = SdeDescriptorPool::Builder(m_Device)
+			.setMaxSets(SdeSwapChain::MAX_FRAMES_IN_FLIGHT)
+			.addPoolSize(vk::DescriptorType::eStorageBuffer, 4 * SdeSwapChain::MAX_FRAMES_IN_FLIGHT)
+			.build();
+
+		// 2. Pipeline, frustum planes and draw count are push constants
+		vk::PushConstantRange pushConstantRange = {};
+		pushConstantRange.stageFlags = vk::ShaderStageFlagBits::eCompute;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(SdeCullPushConstants);
+
+		auto setLayout = m_CullSetLayout->getDescriptorSetLayout();
+		vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+		pipelineLayoutCreateInfo.setLayoutCount = 1;
+		pipelineLayoutCreateInfo.pSetLayouts = &setLayout;
+		pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+		pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+		m_CullPipelineLayout = m_Device.device().createPipelineLayout(pipelineLayoutCreateInfo);
+		m_CullPipeline = std::make_unique<SdePipeline>(m_Device, cullShader, m_CullPipelineLayout);
+
+		// 3. Output buffers, only touched by the GPU
+		auto outputUsage = vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst;
+
+		for (auto& frame : m_Frames) {
+			frame.visibleCommandBuffer = std::make_unique<SdeBuffer>(m_Device, sizeof(vk::DrawIndexedIndirectCommand) * m_MaxDraws, outputUsage);
+			frame.drawCountBuffer = std::make_unique<SdeBuffer>(m_Device, sizeof(uint32_t), outputUsage);
+
+			vk::DescriptorBufferInfo bufferInfos[4] = {
+				{ frame.commandBuffer->getBuffer(), 0, VK_WHOLE_SIZE },
+				{ frame.objectBuffer->getBuffer(), 0, VK_WHOLE_SIZE },
+				{ frame.visibleCommandBuffer->getBuffer(), 0, VK_WHOLE_SIZE },
+				{ frame.drawCountBuffer->getBuffer(), 0, VK_WHOLE_SIZE }
+			};
+
+			frame.cullDescriptorSet = SdeDescriptorWriter(*m_CullSetLayout, *m_CullPool)
+				.writeBuffer(0, &bufferInfos[0])
+				.writeBuffer(1, &bufferInfos[1])
+				.writeBuffer(2, &bufferInfos[2])
+				.writeBuffer(3, &bufferInfos[3])
+				.build();
+		}
+
+		return true;
+	}
+
+	void SdeIndirectDrawList::begin(int frameIndex)
+	{
+		m_FrameIndex = frameIndex;
+		m_DrawCount = 0;
+		m_Culled = false;
+
+		auto& frame = m_Frames[frameIndex];
+		m_MappedCommands = static_cast<vk::DrawIndexedIndirectCommand*>(frame.commandBuffer->getAllocationInfo().pMappedData);
+		m_MappedObjects = static_cast<SdeObjectData*>(frame.objectBuffer->getAllocationInfo().pMappedData);
+	}
+
+	uint32_t SdeIndirectDrawList::addDraw(const SdeModel& model, const glm::mat4& transform, uint32_t materialIndex)
+	{
+		if (m_DrawCount >= m_MaxDraws) {
+			throw std::runtime_error("Indirect draw list is full");
+		}
+
+		uint32_t objectIndex = m_DrawCount++;
+
+		vk::DrawIndexedIndirectCommand command = {};
+		command.indexCount = model.getIndexCount();
+		command.instanceCount = 1;
+		command.firstIndex = model.getFirstIndex();
+		command.vertexOffset = static_cast<int32_t>(model.getVertexOffset());
+		command.firstInstance = objectIndex;
+		m_MappedCommands[objectIndex] = command;
+
+		SdeObjectData object = {};
+		object.transform = transform;
+		object.boundingSphere = model.getBoundingSphere();
+		object.materialIndex = materialIndex;
+		m_MappedObjects[objectIndex] = object;
+
+		return objectIndex;
+	}
+
+	void SdeIndirectDrawList::cull(vk::CommandBuffer commandBuffer, const glm::mat4& viewProjection)
+	{
+		SDE_TRACE_FUNCTION();
+
+		if (!isGpuCullingEnabled() || m_DrawCount == 0) return;
+
+		flushFrame();
+
+		auto& frame = m_Frames[m_FrameIndex];
+		uint32_t stride = sizeof(vk::DrawIndexedIndirectCommand);
+
+		// 1. Reset the draw count. Without an indirect count the full list is drawn,
+		// so the tail past the visible draws must hold empty commands.
+		commandBuffer.fillBuffer(frame.drawCountBuffer->getBuffer(), 0, sizeof(uint32_t), 0);
+		if (!m_Device.drawIndexedIndirectCountFn()) {
+			commandBuffer.fillBuffer(frame.visibleCommandBuffer->getBuffer(), 0, static_cast<vk::DeviceSize>(m_DrawCount) * stride, 0);
+		}
+
+		vk::MemoryBarrier clearBarrier = {};
+		clearBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+		clearBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, {}, clearBarrier, nullptr, nullptr);
+
+		// 2. Test every draw against the frustum and append the visible ones
+		SdeCullPushConstants constants = {};
+		auto frustum = SdeFrustum::fromMatrix(viewProjection);
+		for (uint32_t i = 0; i < SdeFrustum::PlaneCount; i++) {
+			constants.planes[i] = frustum.planes[i];
+		}
+		constants.drawCount = m_DrawCount;
+
+		m_CullPipeline->bind(commandBuffer);
+		commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_CullPipelineLayout, 0, frame.cullDescriptorSet, nullptr);
+		commandBuffer.pushConstants(m_CullPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(constants), &constants);
+		commandBuffer.dispatch((m_DrawCount + 63) / 64, 1, 1);
+
+		// 3. Make the compacted commands visible to the indirect draw
+		vk::MemoryBarrier cullBarrier = {};
+		cullBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+		cullBarrier.dstAccessMask = vk::AccessFlagBits::eIndirectCommandRead;
+		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eDrawIndirect, {}, cullBarrier, nullptr, nullptr);
+
+		m_Culled = true;
+	}
+
+	void SdeIndirectDrawList::draw(vk::CommandBuffer commandBuffer, vk::PipelineLayout pipelineLayout, uint32_t objectSet)
+	{
+		SDE_TRACE_FUNCTION();
+
+		if (m_DrawCount == 0) return;
+
+		if (!m_Culled) {
+			flushFrame();
+		}
+
+		auto& frame = m_Frames[m_FrameIndex];
+		commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, objectSet, frame.descriptorSet, nullptr);
+		m_MeshPool.bind(commandBuffer);
+
+		if (!m_Device.getEnabledFeatures().drawIndirectFirstInstance) {
+			// firstInstance must be 0 in indirect draws, issue the same draws directly
+			for (uint32_t i = 0; i < m_DrawCount; i++) {
+				const auto& command = m_MappedCommands[i];
+				commandBuffer.drawIndexed(command.indexCount, command.instanceCount, command.firstIndex, command.vertexOffset, command.firstInstance);
+			}
+		}
+		else if (m_Culled) {
+			drawIndirect(commandBuffer, frame.visibleCommandBuffer->getBuffer(), frame.drawCountBuffer->getBuffer());
+		}
+		else {
+			drawIndirect(commandBuffer, frame.commandBuffer->getBuffer(), nullptr);
+		}
+	}
+
+	void SdeIndirectDrawList::drawIndirect(vk::CommandBuffer commandBuffer, vk::Buffer buffer, vk::Buffer countBuffer)
+	{
+		uint32_t stride = sizeof(vk::DrawIndexedIndirectCommand);
+
+		auto drawIndexedIndirectCount = m_Device.drawIndexedIndirectCountFn();
+		if (countBuffer && drawIndexedIndirectCount) {
+			drawIndexedIndirectCount(
+				static_cast<VkCommandBuffer>(commandBuffer),
+				static_cast<VkBuffer>(buffer), 0,
+				static_cast<VkBuffer>(countBuffer), 0,
+				m_DrawCount, stride);
+		}
+		else if (m_Device.getEnabledFeatures().multiDrawIndirect) {
+			commandBuffer.drawIndexedIndirect(buffer, 0, m_DrawCount, stride);
+		}
+		else {
+			for (uint32_t i = 0; i < m_DrawCount; i++) {
+				commandBuffer.drawIndexedIndirect(buffer, static_cast<vk::DeviceSize>(i) * stride, 1, stride);
+			}
+		}
+	}
+
+	void SdeIndirectDrawList::flushFrame()
+	{
+		auto& frame = m_Frames[m_FrameIndex];
+		auto allocator = m_Device.getAllocator();
+
+		allocator.flushAllocation(frame.commandBuffer->getAllocation(), 0, sizeof(vk::DrawIndexedIndirectCommand) * m_DrawCount);
+		allocator.flushAllocation(frame.objectBuffer->getAllocation(), 0, sizeof(SdeObjectData) * m_DrawCount);
+	}
+
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "sde_device.h"
+#include "sde_buffer.h"
+#include "sde_descriptors.h"
+#include "sde_mesh_pool.h"
+#include "sde_model.h"
+#include "sde_swap_chain.h"
+#include "sde_pipeline.h"
+#include "sde_frustum.h"
+
+#include <vulkan/vulkan.hpp>
+#include <memory>
+#include <vector>
+
+namespace sde {
+
+	// Matches ObjectData in shaders/indirect.vert and shaders/cull.comp (std430)
+	struct SdeObjectData {
+		glm::mat4 transform{ 1.f };
+		glm::vec4 boundingSphere{ 0.f };
+		uint32_t materialIndex = 0;
+		uint32_t padding[3] = {};
+	};
+
+	// Matches CullConstants in shaders/cull.comp
+	struct SdeCullPushConstants {
+		glm::vec4 planes[SdeFrustum::PlaneCount];
+		uint32_t drawCount = 0;
+	};
+
+	// Per frame list of draws written to GPU buffers and submitted with drawIndexedIndirect.
+	// Each draw gets firstInstance = its object index, shaders fetch SdeObjectData with gl_InstanceIndex.
+	// With GPU culling enabled a compute pass compacts the visible draws before the render pass.
+	class SdeIndirectDrawList {
+	public:
+		static constexpr uint32_t DEFAULT_MAX_DRAWS = 16384;
+
+		SdeIndirectDrawList(SdeDevice& device, SdeMeshPool& meshPool, uint32_t maxDraws = DEFAULT_MAX_DRAWS);
+		~SdeIndirectDrawList();
+
+		SdeIndirectDrawList(const SdeIndirectDrawList&) = delete;
+		SdeIndirectDrawList& operator=(const SdeIndirectDrawList&) = delete;
+
+		// Clears the list, frameIndex must not be in flight anymore
+		void begin(int frameIndex);
+		uint32_t addDraw(const SdeModel& model, const glm::mat4& transform, uint32_t materialIndex = 0);
+
+		// Needs drawIndirectFirstInstance, returns false and stays disabled otherwise
+		bool enableGpuCulling(SdeShaderCode cullShader);
+		bool isGpuCullingEnabled() const { return m_CullPipeline != nullptr; }
+
+		// Records the culling dispatch, must be called outside of a render pass before draw()
+		void cull(vk::CommandBuffer commandBuffer, const glm::mat4& viewProjection);
+
+		// Binds the object buffer at objectSet, the mesh pool, and issues every draw
+		void draw(vk::CommandBuffer commandBuffer, vk::PipelineLayout pipelineLayout, uint32_t objectSet);
+
+		vk::DescriptorSetLayout getDescriptorSetLayout() { return m_DescriptorSetLayout->getDescriptorSetLayout(); }
+		uint32_t getDrawCount() const { return m_DrawCount; }
+		uint32_t getMaxDraws() const { return m_MaxDraws; }
+
+	private:
+		struct FrameBuffers {
+			std::unique_ptr<SdeBuffer> commandBuffer;
+			std::unique_ptr<SdeBuffer> objectBuffer;
+			vk::DescriptorSet descriptorSet;
+
+			// GPU culling output
+			std::unique_ptr<SdeBuffer> visibleCommandBuffer;
+			std::unique_ptr<SdeBuffer> drawCountBuffer;
+			vk::DescriptorSet cullDescriptorSet;
+		};
+
+		void flushFrame();
+		void drawIndirect(vk::CommandBuffer commandBuffer, vk::Buffer buffer, vk::Buffer countBuffer);
+
+	private:
+		SdeDevice& m_Device;
+		SdeMeshPool& m_MeshPool;
+		uint32_t m_MaxDraws;
+
+		std::unique_ptr<SdeDescriptorSetLayout> m_DescriptorSetLayout;
+		std::unique_ptr<SdeDescriptorPool> m_DescriptorPool;
+		std::vector<FrameBuffers> m_Frames;
+
+		std::unique_ptr<SdeDescriptorSetLayout> m_CullSetLayout;
+		std::unique_ptr<SdeDescriptorPool> m_CullPool;
+		vk::PipelineLayout m_CullPipelineLayout;
+		std::unique_ptr<SdePipeline> m_CullPipeline;
+
+		int m_FrameIndex = 0;
+		uint32_t m_DrawCount = 0;
+		bool m_Culled = false;
+		vk::DrawIndexedIndirectCommand* m_MappedCommands = nullptr;
+		SdeObjectData* m_MappedObjects = nullptr;
+	};
+
+}
@@ -0,0 +1,230 @@
+#include "sde_job_system.h"
+#include "sde_trace.h"
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+namespace sde {
+
+	// Set on worker threads only
+	static thread_local const SdeJobSystem* t_JobSystem = nullptr;
+	static thread_local uint32_t t_QueueIndex = 0;
+
+	SdeJobSystem::SdeJobSystem(uint32_t workerCount)
+	{
+		if (workerCount == 0) {
+			uint32_t hardwareThreads = std::thread::hardware_concurrency();
+			workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+		}
+
+		for (uint32_t i = 0; i < workerCount + 1; i++) {
+			m_Queues.push_back(std::make_unique<Queue>());
+		}
+
+		for (uint32_t i = 0; i < workerCount; i++) {
+			m_Workers.emplace_back(&SdeJobSystem::workerLoop, this, i);
+		}
+	}
+
+	SdeJobSystem::~SdeJobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_SleepMutex);
+			m_Stop = true;
+		}
+		m_SleepCondition.notify_all();
+
+		for (auto& worker : m_Workers) {
+			worker.join();
+		}
+	}
+
+	void SdeJobSystem::run(std::function<void()> job, SdeJobCounter* counter)
+	{
+		if (counter) {
+			counter->m_Count.fetch_add(1, std::memory_order_relaxed);
+		}
+		push({ std::move(job), counter });
+	}
+
+	void SdeJobSystem::runAfter(SdeJobCounter& dependency, std::function<void()> job, SdeJobCounter* counter)
+	{
+		if (counter) {
+			counter->m_Count.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(dependency.m_Mutex);
+			if (!dependency.isDone()) {
+				dependency.m_Continuations.push_back({ std::move(job), counter });
+				return;
+			}
+		}
+		push({ std::move(job), counter });
+	}
+
+	void SdeJobSystem::parallelFor(uint32_t count, uint32_t minBatch, std::function<void(uint32_t begin, uint32_t end)> function, SdeJobCounter& counter)
+	{
+		if (count == 0) return;
+
+		uint32_t rangeCount = std::max(1u, std::min(getThreadCount(), count / std::max(minBatch, 1u)));
+		for (uint32_t i = 0; i < rangeCount; i++) {
+			uint32_t begin = static_cast<uint32_t>(static_cast<uint64_t>(count) * i / rangeCount);
+			uint32_t end = static_cast<uint32_t>(static_cast<uint64_t>(count) * (i + 1) / rangeCount);
+			run([function, begin, end]() { function(begin, end); }, &counter);
+		}
+	}
+
+	void SdeJobSystem::wait(SdeJobCounter& counter)
+	{
+		SDE_TRACE_FUNCTION();
+
+		while (!counter.isDone()) {
+			SdeJob job;
+			if (pop(job)) {
+				execute(job);
+				continue;
+			}
+
+			// Nothing to help with, sleep until a job is queued or a counter finishes
+			std::unique_lock<std::mutex> lock(m_SleepMutex);
+			m_SleepCondition.wait(lock, [&]() {
+				return counter.isDone() || m_QueuedCount.load(std::memory_order_acquire) > 0;
+			});
+		}
+
+		// The last finish() may still hold the mutex, the counter must not be released before it let go
+		std::exception_ptr error;
+		{
+			std::lock_guard<std::mutex> lock(counter.m_Mutex);
+			std::swap(error, counter.m_Error);
+		}
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+	uint32_t SdeJobSystem::currentQueue() const
+	{
+		return t_JobSystem == this ? t_QueueIndex : static_cast<uint32_t>(m_Queues.size() - 1);
+	}
+
+	void SdeJobSystem::push(SdeJob job)
+	{
+		// Counted before it is visible, so a thief can never take the count below zero
+		m_QueuedCount.fetch_add(1, std::memory_order_release);
+
+		auto& queue = *m_Queues[currentQueue()];
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.jobs.push_back(std::move(job));
+		}
+		wake(false);
+	}
+
+	bool SdeJobSystem::pop(SdeJob& job)
+	{
+		if (m_QueuedCount.load(std::memory_order_acquire) == 0) return false;
+
+		// Own queue first, newest job while it is still hot in cache
+		uint32_t own = currentQueue();
+		{
+			auto& queue = *m_Queues[own];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.jobs.empty()) {
+				job = std::move(queue.jobs.back());
+				queue.jobs.pop_back();
+				m_QueuedCount.fetch_sub(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+
+		// Steal the oldest job of another queue, starting next to our own so thieves spread out
+		uint32_t queueCount = static_cast<uint32_t>(m_Queues.size());
+		for (uint32_t i = 1; i < queueCount; i++) {
+			auto& queue = *m_Queues[(own + i) % queueCount];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.jobs.empty()) {
+				job = std::move(queue.jobs.front());
+				queue.jobs.pop_front();
+				m_QueuedCount.fetch_sub(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void SdeJobSystem::execute(SdeJob& job)
+	{
+		try {
+			job.function();
+		}
+		catch (...) {
+			if (job.counter) {
+				std::lock_guard<std::mutex> lock(job.counter->m_Mutex);
+				if (!job.counter->m_Error) job.counter->m_Error = std::current_exception();
+			}
+			else {
+				std::cout << "Job system: uncounted job threw an exception" << std::endl;
+			}
+		}
+
+		finish(job.counter);
+	}
+
+	void SdeJobSystem::finish(SdeJobCounter* counter)
+	{
+		if (!counter) return;
+
+		std::vector<SdeJob> continuations;
+		{
+			std::lock_guard<std::mutex> lock(counter->m_Mutex);
+			if (counter->m_Count.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+			std::swap(continuations, counter->m_Continuations);
+		}
+
+		// The counter may be gone from here on
+		for (auto& continuation : continuations) {
+			push(std::move(continuation));
+		}
+		wake(true);
+	}
+
+	void SdeJobSystem::wake(bool all)
+	{
+		// Taking the mutex orders this with a sleeper checking its predicate, no wake up is lost
+		{
+			std::lock_guard<std::mutex> lock(m_SleepMutex);
+		}
+
+		if (all) {
+			m_SleepCondition.notify_all();
+		}
+		else {
+			m_SleepCondition.notify_one();
+		}
+	}
+
+	void SdeJobSystem::workerLoop(uint32_t index)
+	{
+		SDE_TRACE_THREAD_NAME("Job worker " + std::to_string(index));
+
+		t_JobSystem = this;
+		t_QueueIndex = index;
+
+		while (true) {
+			SdeJob job;
+			if (pop(job)) {
+				execute(job);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(m_SleepMutex);
+			m_SleepCondition.wait(lock, [&]() { return m_Stop || m_QueuedCount.load(std::memory_order_acquire) > 0; });
+			if (m_Stop && m_QueuedCount.load(std::memory_order_acquire) == 0) return;
+		}
+	}
+
+}
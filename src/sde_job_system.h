@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sde {
+
+	class SdeJobCounter;
+
+	struct SdeJob {
+		std::function<void()> function;
+		SdeJobCounter* counter = nullptr;
+	};
+
+	// Number of unfinished jobs, to wait on or to start other jobs after.
+	// Must outlive the jobs it counts, it can be reused once it reached zero.
+	class SdeJobCounter {
+	public:
+		SdeJobCounter() = default;
+
+		SdeJobCounter(const SdeJobCounter&) = delete;
+		SdeJobCounter& operator=(const SdeJobCounter&) = delete;
+
+		bool isDone() const { return m_Count.load(std::memory_order_acquire) == 0; }
+
+	private:
+		friend class SdeJobSystem;
+
+		std::atomic<uint32_t> m_Count{ 0 };
+		// Guards the continuations and the error, and the last decrement so waiters can't free the counter under it
+		std::mutex m_Mutex;
+		std::vector<SdeJob> m_Continuations;
+		std::exception_ptr m_Error;
+	};
+
+	// Shared worker threads for engine tasks. Every worker owns a deque, it pops its own jobs LIFO
+	// and steals the oldest jobs of the others when it runs dry. Threads that are not workers
+	// push to a shared queue and help executing jobs while they wait.
+	class SdeJobSystem {
+	public:
+		// workerCount 0 picks one per spare hardware thread, there is always at least one worker
+		explicit SdeJobSystem(uint32_t workerCount = 0);
+		// Runs every job still queued, then joins the workers
+		~SdeJobSystem();
+
+		SdeJobSystem(const SdeJobSystem&) = delete;
+		SdeJobSystem& operator=(const SdeJobSystem&) = delete;
+
+		void run(std::function<void()> job, SdeJobCounter* counter = nullptr);
+		// Queues job once dependency reached zero, immediately if it already has
+		void runAfter(SdeJobCounter& dependency, std::function<void()> job, SdeJobCounter* counter = nullptr);
+		// Splits [0, count) into about one range per thread, none smaller than minBatch
+		void parallelFor(uint32_t count, uint32_t minBatch, std::function<void(uint32_t begin, uint32_t end)> function, SdeJobCounter& counter);
+
+		// Executes queued jobs on the calling thread until counter reaches zero.
+		// Rethrows the first exception thrown by a job counted by it.
+		void wait(SdeJobCounter& counter);
+
+		uint32_t getWorkerCount() const { return static_cast<uint32_t>(m_Workers.size()); }
+		// Workers plus the thread calling wait(), the useful number of parallel ranges
+		uint32_t getThreadCount() const { return getWorkerCount() + 1; }
+
+	private:
+		struct Queue {
+			std::deque<SdeJob> jobs;
+			std::mutex mutex;
+		};
+
+		uint32_t currentQueue() const;
+		void push(SdeJob job);
+		bool pop(SdeJob& job);
+		void execute(SdeJob& job);
+		void finish(SdeJobCounter* counter);
+		void wake(bool all);
+		void workerLoop(uint32_t index);
+
+	private:
+		// One per worker, the last one is shared by every other thread
+		std::vector<std::unique_ptr<Queue>> m_Queues;
+		std::atomic<uint32_t> m_QueuedCount{ 0 };
+
+		std::mutex m_SleepMutex;
+		std::condition_variable m_SleepCondition;
+		bool m_Stop = false;
+
+		std::vector<std::thread> m_Workers;
+	};
+
+}
@@ -0,0 +1,137 @@
+#include "sde_mesh_pool.h"
+#include "sde_deletion_queue.h"
+
+#include <iterator>
+
+namespace sde {
+
+	// Free list allocator
+
+	SdeFreeListAllocator::SdeFreeListAllocator(uint32_t capacity) : m_Capacity(capacity)
+	{
+		m_FreeBlocks[0] = capacity;
+	}
+
+	std::optional<uint32_t> SdeFreeListAllocator::allocate(uint32_t size)
+	{
+		if (size == 0) return std::nullopt;
+
+		auto best = m_FreeBlocks.end();
+		for (auto it = m_FreeBlocks.begin(); it != m_FreeBlocks.end(); ++it) {
+			if (it->second < size) continue;
+			if (best == m_FreeBlocks.end() || it->second < best->second) {
+				best = it;
+				if (best->second == size) break;
+			}
+		}
+
+		if (best == m_FreeBlocks.end()) return std::nullopt;
+
+		uint32_t offset = best->first;
+		uint32_t remaining = best->second - size;
+
+		m_FreeBlocks.erase(best);
+		if (remaining > 0) {
+			m_FreeBlocks[offset + size] = remaining;
+		}
+
+		m_Used += size;
+		return offset;
+	}
+
+	void SdeFreeListAllocator::free(uint32_t offset, uint32_t size)
+	{
+		if (size == 0) return;
+
+		m_Used -= size;
+
+		auto next = m_FreeBlocks.lower_bound(offset);
+
+		// Merge with the block right after
+		if (next != m_FreeBlocks.end() && offset + size == next->first) {
+			size += next->second;
+			next = m_FreeBlocks.erase(next);
+		}
+
+		// Merge with the block right before
+		if (next != m_FreeBlocks.begin()) {
+			auto previous = std::prev(next);
+			if (previous->first + previous->second == offset) {
+				previous->second += size;
+				return;
+			}
+		}
+
+		m_FreeBlocks[offset] = size;
+	}
+
+	// Mesh pool
+
+	SdeMeshPool::SdeMeshPool(SdeDevice& device, uint32_t vertexStride, uint32_t vertexCapacity, uint32_t indexCapacity)
+		: m_Device(device), m_VertexStride(vertexStride), m_Ranges(std::make_shared<Ranges>(Ranges{ vertexCapacity, indexCapacity }))
+	{
+		m_VertexBuffer = std::make_unique<SdeBuffer>(m_Device,
+			static_cast<uint64_t>(vertexCapacity) * vertexStride,
+			vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst);
+
+		m_IndexBuffer = std::make_unique<SdeBuffer>(m_Device,
+			static_cast<uint64_t>(indexCapacity) * sizeof(uint32_t),
+			vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst);
+	}
+
+	SdeMeshAllocation SdeMeshPool::allocate(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, SdeUploadHandle& uploadHandle)
+	{
+		auto vertexOffset = m_Ranges->vertices.allocate(vertexCount);
+		if (!vertexOffset) {
+			throw std::runtime_error("Mesh pool is out of vertex space");
+		}
+
+		auto firstIndex = m_Ranges->indices.allocate(indexCount);
+		if (!firstIndex) {
+			m_Ranges->vertices.free(*vertexOffset, vertexCount);
+			throw std::runtime_error("Mesh pool is out of index space");
+		}
+
+		SdeMeshAllocation allocation;
+		allocation.vertexOffset = *vertexOffset;
+		allocation.vertexCount = vertexCount;
+		allocation.firstIndex = *firstIndex;
+		allocation.indexCount = indexCount;
+
+		auto& uploadManager = m_Device.uploadManager();
+		uploadManager.uploadBuffer(
+			m_VertexBuffer->getBuffer(),
+			vertices,
+			static_cast<vk::DeviceSize>(vertexCount) * m_VertexStride,
+			static_cast<vk::DeviceSize>(allocation.vertexOffset) * m_VertexStride);
+
+		uploadHandle = uploadManager.uploadBuffer(
+			m_IndexBuffer->getBuffer(),
+			indices,
+			static_cast<vk::DeviceSize>(indexCount) * sizeof(uint32_t),
+			static_cast<vk::DeviceSize>(allocation.firstIndex) * sizeof(uint32_t));
+
+		return allocation;
+	}
+
+	void SdeMeshPool::free(const SdeMeshAllocation& allocation)
+	{
+		std::weak_ptr<Ranges> ranges = m_Ranges;
+		m_Device.deletionQueue().push([ranges, allocation]() {
+			if (auto locked = ranges.lock()) {
+				locked->vertices.free(allocation.vertexOffset, allocation.vertexCount);
+				locked->indices.free(allocation.firstIndex, allocation.indexCount);
+			}
+		});
+	}
+
+	void SdeMeshPool::bind(vk::CommandBuffer commandBuffer)
+	{
+		vk::Buffer buffers[] = { m_VertexBuffer->getBuffer() };
+		vk::DeviceSize offsets[] = { 0 };
+
+		commandBuffer.bindVertexBuffers(0, 1, buffers, offsets);
+		commandBuffer.bindIndexBuffer(m_IndexBuffer->getBuffer(), 0, vk::IndexType::eUint32);
+	}
+
+}
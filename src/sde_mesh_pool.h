@@ -0,0 +1,83 @@
+#pragma once
+
+#include "sde_device.h"
+#include "sde_buffer.h"
+#include "sde_upload_manager.h"
+
+#include <vulkan/vulkan.hpp>
+#include <map>
+#include <memory>
+#include <optional>
+
+namespace sde {
+
+	// Best-fit free list over [0, capacity), neighbouring free blocks are merged back on free
+	class SdeFreeListAllocator {
+	public:
+		SdeFreeListAllocator(uint32_t capacity);
+
+		std::optional<uint32_t> allocate(uint32_t size);
+		void free(uint32_t offset, uint32_t size);
+
+		uint32_t capacity() const { return m_Capacity; }
+		uint32_t used() const { return m_Used; }
+
+	private:
+		uint32_t m_Capacity;
+		uint32_t m_Used = 0;
+		std::map<uint32_t, uint32_t> m_FreeBlocks; // offset -> size
+	};
+
+	struct SdeMeshAllocation {
+		uint32_t vertexOffset = 0;
+		uint32_t vertexCount = 0;
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+	};
+
+	// Shared device local vertex and index buffers, meshes are ranges inside them.
+	// Binding the pool once allows any number of draws with vertexOffset/firstIndex.
+	class SdeMeshPool {
+	public:
+		static constexpr uint32_t DEFAULT_VERTEX_CAPACITY = 1 << 20;
+		static constexpr uint32_t DEFAULT_INDEX_CAPACITY = 1 << 22;
+
+		SdeMeshPool(
+			SdeDevice& device,
+			uint32_t vertexStride,
+			uint32_t vertexCapacity = DEFAULT_VERTEX_CAPACITY,
+			uint32_t indexCapacity = DEFAULT_INDEX_CAPACITY
+		);
+
+		SdeMeshPool(const SdeMeshPool&) = delete;
+		SdeMeshPool& operator=(const SdeMeshPool&) = delete;
+
+		// Copies the data into the pool through the upload manager
+		SdeMeshAllocation allocate(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, SdeUploadHandle& uploadHandle);
+		// The ranges are handed out again once the frames that may still draw from them retired
+		void free(const SdeMeshAllocation& allocation);
+
+		void bind(vk::CommandBuffer commandBuffer);
+
+		SdeDevice& device() { return m_Device; }
+		vk::Buffer getVertexBuffer() { return m_VertexBuffer->getBuffer(); }
+		vk::Buffer getIndexBuffer() { return m_IndexBuffer->getBuffer(); }
+		uint32_t getVertexStride() const { return m_VertexStride; }
+
+	private:
+		struct Ranges {
+			SdeFreeListAllocator vertices;
+			SdeFreeListAllocator indices;
+		};
+
+	private:
+		SdeDevice& m_Device;
+		uint32_t m_VertexStride;
+
+		// Shared with pending frees in the deletion queue, which outlive the pool when it goes first
+		std::shared_ptr<Ranges> m_Ranges;
+
+		std::unique_ptr<SdeBuffer> m_VertexBuffer, m_IndexBuffer;
+	};
+
+}
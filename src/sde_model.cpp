@@ -1,4 +1,8 @@
 #include "sde_model.h"
+#include "sde_trace.h"
+#include "sde_obj_loader.h"
+
+#include <algorithm>
 
 namespace sde {
     std::vector<vk::VertexInputBindingDescription> SdeModel::Vertex::getBindingDescriptions()
@@ -16,88 +20,103 @@ namespace sde {
     {
         std::vector<vk::VertexInputAttributeDescription> attributes = {};
 
-        attributes.push_back({ 0, 0, vk::Format::eR32G32B32A32Sfloat, offsetof(Vertex, pos) });
-        attributes.push_back({ 1, 0, vk::Format::eR32G32B32A32Sfloat, offsetof(Vertex, color) });
+        attributes.push_back({ 0, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, pos) });
+        attributes.push_back({ 1, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, color) });
 
         return attributes;
     }
 
-    SdeModel::SdeModel(SdeDevice& device, const Builder& builder) : m_Device(device)
+    vk::VertexInputBindingDescription SdeModel::InstanceData::getBindingDescription()
     {
-        createVertexBuffers(builder.vertices);
-        createIndexBuffers(builder.indices);
-    }
+        vk::VertexInputBindingDescription binding = {};
+        binding.binding = INSTANCE_BINDING;
+        binding.stride = sizeof(InstanceData);
+        binding.inputRate = vk::VertexInputRate::eInstance;
 
-    SdeModel::~SdeModel()
-    {
+        return binding;
     }
 
-    void SdeModel::bind(vk::CommandBuffer commandBuffer)
+    std::vector<vk::VertexInputAttributeDescription> SdeModel::InstanceData::getAttributeDescriptions()
     {
-        vk::Buffer buffers[] = { m_VertexBuffer->getBuffer() };
-        vk::DeviceSize offsets[] = { 0 };
-
-        commandBuffer.bindVertexBuffers(0, 1, buffers, offsets);
+        std::vector<vk::VertexInputAttributeDescription> attributes = {};
 
-        if (m_HasIndexBuffer) {
-            commandBuffer.bindIndexBuffer(m_IndexBuffer->getBuffer(), 0, vk::IndexType::eUint32);
+        // A mat4 takes one location per column
+        for (uint32_t column = 0; column < 4; column++) {
+            attributes.push_back({ 2 + column, INSTANCE_BINDING, vk::Format::eR32G32B32A32Sfloat, static_cast<uint32_t>(offsetof(InstanceData, transform) + sizeof(glm::vec4) * column) });
         }
-    }
+        attributes.push_back({ 6, INSTANCE_BINDING, vk::Format::eR32G32B32A32Sfloat, offsetof(InstanceData, color) });
 
-    void SdeModel::draw(vk::CommandBuffer commandBuffer)
-    {
-        if (m_HasIndexBuffer) {
-            commandBuffer.drawIndexed(m_IndexCount, 1, 0, 0, 0);
-        }
-        else {
-            commandBuffer.draw(m_VertexCount, 1, 0, 0);
-        }
+        return attributes;
     }
 
-    void SdeModel::createVertexBuffers(const std::vector<Vertex>& vertices)
+    SdeModel::SdeModel(SdeMeshPool& meshPool, const Builder& builder) : m_Device(meshPool.device()), m_MeshPool(meshPool)
     {
-        m_VertexCount = static_cast<uint32_t>(vertices.size());
+        SDE_TRACE_ZONE("SdeModel::SdeModel");
 
-        uint32_t vertexSize = sizeof(vertices[0]);
-        uint64_t bufferSize = static_cast<uint64_t>(vertexSize) * m_VertexCount;
+        if (builder.vertices.empty()) {
+            throw std::runtime_error("Model has no vertices");
+        }
 
-        SdeBuffer stagingBuffer(m_Device, bufferSize,
-            vk::BufferUsageFlagBits::eTransferSrc, 
-            vma::AllocationCreateFlagBits::eHostAccessSequentialWrite | vma::AllocationCreateFlagBits::eMapped);
+        uint32_t vertexCount = static_cast<uint32_t>(builder.vertices.size());
 
-        stagingBuffer.map(); // This is not needed
-        stagingBuffer.writeTo((void*)vertices.data());
+        // Bounding sphere around the center of the vertex bounds, used for culling
+        glm::vec3 minPos = builder.vertices[0].pos;
+        glm::vec3 maxPos = builder.vertices[0].pos;
+        for (const auto& vertex : builder.vertices) {
+            minPos = glm::min(minPos, vertex.pos);
+            maxPos = glm::max(maxPos, vertex.pos);
+        }
 
-        m_VertexBuffer = std::make_unique<SdeBuffer>(m_Device, bufferSize,
-            vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst);
+        glm::vec3 center = (minPos + maxPos) * 0.5f;
+        float radius = 0.0f;
+        for (const auto& vertex : builder.vertices) {
+            radius = std::max(radius, glm::length(vertex.pos - center));
+        }
+        m_BoundingSphere = glm::vec4(center, radius);
+
+        // Every pool mesh is indexed, non indexed models get the trivial index list
+        std::vector<uint32_t> sequentialIndices;
+        const std::vector<uint32_t>* indices = &builder.indices;
+        if (indices->empty()) {
+            sequentialIndices.resize(vertexCount);
+            for (uint32_t i = 0; i < vertexCount; i++) {
+                sequentialIndices[i] = i;
+            }
+            indices = &sequentialIndices;
+        }
 
-        m_Device.copyBuffer(stagingBuffer.getBuffer(), m_VertexBuffer->getBuffer(), bufferSize);
+        m_Allocation = m_MeshPool.allocate(
+            builder.vertices.data(),
+            vertexCount,
+            indices->data(),
+            static_cast<uint32_t>(indices->size()),
+            m_UploadHandle
+        );
     }
 
-    void SdeModel::createIndexBuffers(const std::vector<uint32_t>& indices)
+    SdeModel::~SdeModel()
     {
-        m_HasIndexBuffer = indices.size() > 0;
-        m_IndexCount = indices.size();
-
-        if (!m_HasIndexBuffer) return;
-
-        uint32_t indexSize = sizeof(indices[0]);
-        uint64_t bufferSize = static_cast<uint64_t>(indexSize) * m_IndexCount;
-
-        SdeBuffer stagingBuffer(m_Device, bufferSize,
-            vk::BufferUsageFlagBits::eTransferSrc,
-            vma::AllocationCreateFlagBits::eHostAccessSequentialWrite | vma::AllocationCreateFlagBits::eMapped);
+        m_MeshPool.free(m_Allocation);
+    }
 
-        stagingBuffer.map(); // This is not needed
-        stagingBuffer.writeTo((void*)indices.data());
+    void SdeModel::bind(vk::CommandBuffer commandBuffer)
+    {
+        m_MeshPool.bind(commandBuffer);
+    }
 
-        m_IndexBuffer = std::make_unique<SdeBuffer>(m_Device, bufferSize,
-            vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst);
+    void SdeModel::draw(vk::CommandBuffer commandBuffer)
+    {
+        commandBuffer.drawIndexed(m_Allocation.indexCount, 1, m_Allocation.firstIndex, static_cast<int32_t>(m_Allocation.vertexOffset), 0);
+    }
 
-        m_Device.copyBuffer(stagingBuffer.getBuffer(), m_IndexBuffer->getBuffer(), bufferSize);
+    void SdeModel::drawInstanced(vk::CommandBuffer commandBuffer, vk::Buffer instanceBuffer, uint32_t count, vk::DeviceSize offset)
+    {
+        commandBuffer.bindVertexBuffers(INSTANCE_BINDING, instanceBuffer, offset);
+        commandBuffer.drawIndexed(m_Allocation.indexCount, count, m_Allocation.firstIndex, static_cast<int32_t>(m_Allocation.vertexOffset), 0);
     }
 
-    void SdeModel::Builder::loadModel(const std::string& filePath)
+    void SdeModel::Builder::loadModel(const std::string& filePath, SdeJobSystem* jobSystem)
     {
+        SdeObjLoader::load(filePath, vertices, indices, jobSystem);
     }
 }
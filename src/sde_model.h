@@ -6,12 +6,16 @@
 
 #include "sde_device.h"
 #include "sde_buffer.h"
+#include "sde_upload_manager.h"
+#include "sde_mesh_pool.h"
 
 #include <vulkan/vulkan.hpp>
 #include <vector>
 
 namespace sde {
 
+	class SdeJobSystem;
+
 	class SdeModel {
 	public:
 		struct Vertex {
@@ -22,34 +26,58 @@ namespace sde {
 			static std::vector<vk::VertexInputAttributeDescription> getAttributeDescriptions();
 		};
 
+		// Per instance vertex data, binding 1 with vk::VertexInputRate::eInstance
+		struct InstanceData {
+			glm::mat4 transform{ 1.f };
+			glm::vec4 color{ 1.f };
+
+			static vk::VertexInputBindingDescription getBindingDescription();
+			static std::vector<vk::VertexInputAttributeDescription> getAttributeDescriptions();
+		};
+
+		static constexpr uint32_t INSTANCE_BINDING = 1;
+
 		static std::vector<Vertex> TriangleVertices;
 
 		struct Builder {
 			std::vector<Vertex> vertices = {};
 			std::vector<uint32_t> indices = {};
 
-			void loadModel(const std::string& filePath);
+			// Wavefront OBJ through SdeObjLoader, parsed on jobSystem when given
+			void loadModel(const std::string& filePath, SdeJobSystem* jobSystem = nullptr);
 		};
 
-		SdeModel(SdeDevice& device, const Builder& builder);
+		SdeModel(SdeMeshPool& meshPool, const Builder& builder);
 		~SdeModel();
 
 		SdeModel(const SdeModel&) = delete;
 		SdeModel& operator=(const SdeModel&) = delete;
 
+		// Binds the whole mesh pool, only needed once for every model of the pool
 		void bind(vk::CommandBuffer commandBuffer);
 		void draw(vk::CommandBuffer commandBuffer);
+		// Binds instanceBuffer (InstanceData array) at INSTANCE_BINDING and draws count copies in one call
+		void drawInstanced(vk::CommandBuffer commandBuffer, vk::Buffer instanceBuffer, uint32_t count, vk::DeviceSize offset = 0);
 
-	private:
-		void createVertexBuffers(const std::vector<Vertex>& vertices);
-		void createIndexBuffers(const std::vector<uint32_t>& indices);
+		// Location inside the mesh pool buffers
+		uint32_t getVertexOffset() const { return m_Allocation.vertexOffset; }
+		uint32_t getFirstIndex() const { return m_Allocation.firstIndex; }
+		uint32_t getIndexCount() const { return m_Allocation.indexCount; }
 
-		SdeDevice& m_Device;
+		// Model space bounding sphere, xyz = center, w = radius
+		const glm::vec4& getBoundingSphere() const { return m_BoundingSphere; }
+
+		// Uploads are batched, the renderer submits them before the next frame that draws this model
+		SdeUploadHandle getUploadHandle() const { return m_UploadHandle; }
+		bool isUploaded() { return m_Device.uploadManager().isComplete(m_UploadHandle); }
 
-		uint32_t m_VertexCount = 0, m_IndexCount = 0;
-		bool m_HasIndexBuffer = false;
+	private:
+		SdeDevice& m_Device;
+		SdeMeshPool& m_MeshPool;
 
-		std::unique_ptr<SdeBuffer> m_VertexBuffer, m_IndexBuffer;
+		SdeMeshAllocation m_Allocation;
+		glm::vec4 m_BoundingSphere{ 0.f };
+		SdeUploadHandle m_UploadHandle = 0;
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,504 @@
+#include "sde_obj_loader.h"
+#include "sde_trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace sde {
+
+	namespace {
+
+		// Read only view of a whole file
+		class MappedFile {
+		public:
+			MappedFile(const std::string& path)
+			{
+#ifdef _WIN32
+				m_File = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+				if (m_File == INVALID_HANDLE_VALUE) {
+					throw std::runtime_error("Failed to open model file: " + path);
+				}
+
+				LARGE_INTEGER size = {};
+				if (!GetFileSizeEx(m_File, &size)) {
+					close();
+					throw std::runtime_error("Failed to read the size of model file: " + path);
+				}
+				m_Size = static_cast<size_t>(size.QuadPart);
+				if (m_Size == 0) return;
+
+				m_Mapping = CreateFileMappingA(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				if (m_Mapping) {
+					m_Data = static_cast<const char*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+				}
+#else
+				m_File = open(path.c_str(), O_RDONLY);
+				if (m_File < 0) {
+					throw std::runtime_error("Failed to open model file: " + path);
+				}
+
+				struct stat status = {};
+				if (fstat(m_File, &status) != 0) {
+					close();
+					throw std::runtime_error("Failed to read the size of model file: " + path);
+				}
+				m_Size = static_cast<size_t>(status.st_size);
+				if (m_Size == 0) return;
+
+				void* data = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, m_File, 0);
+				if (data != MAP_FAILED) {
+					m_Data = static_cast<const char*>(data);
+					// Read front to back by every chunk
+					madvise(data, m_Size, MADV_SEQUENTIAL);
+				}
+#endif
+				if (!m_Data) {
+					close();
+					throw std::runtime_error("Failed to map model file: " + path);
+				}
+			}
+
+			~MappedFile() { close(); }
+
+			MappedFile(const MappedFile&) = delete;
+			MappedFile& operator=(const MappedFile&) = delete;
+
+			const char* data() const { return m_Data; }
+			size_t size() const { return m_Size; }
+
+		private:
+			void close()
+			{
+#ifdef _WIN32
+				if (m_Data) UnmapViewOfFile(m_Data);
+				if (m_Mapping) CloseHandle(m_Mapping);
+				if (m_File != INVALID_HANDLE_VALUE) CloseHandle(m_File);
+				m_Mapping = nullptr;
+				m_File = INVALID_HANDLE_VALUE;
+#else
+				if (m_Data) munmap(const_cast<char*>(m_Data), m_Size);
+				if (m_File >= 0) ::close(m_File);
+				m_File = -1;
+#endif
+				m_Data = nullptr;
+			}
+
+		private:
+			const char* m_Data = nullptr;
+			size_t m_Size = 0;
+#ifdef _WIN32
+			HANDLE m_File = INVALID_HANDLE_VALUE;
+			HANDLE m_Mapping = nullptr;
+#else
+			int m_File = -1;
+#endif
+		};
+
+		// Whole lines of the file, counted first and then parsed into their slice of the output
+		struct Chunk {
+			const char* begin;
+			const char* end;
+
+			uint32_t positionCount = 0;
+			size_t indexCount = 0;
+
+			uint32_t firstPosition = 0;
+			size_t firstIndex = 0;
+		};
+
+		inline bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+		inline bool isDigit(char c) { return static_cast<unsigned char>(c - '0') < 10; }
+
+		inline void skipBlanks(const char*& p, const char* end)
+		{
+			while (p < end && isBlank(*p)) p++;
+		}
+
+		inline void skipToken(const char*& p, const char* end)
+		{
+			while (p < end && !isBlank(*p) && *p != '\n') p++;
+		}
+
+		inline void skipLine(const char*& p, const char* end)
+		{
+			const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+			p = newline ? newline + 1 : end;
+		}
+
+		// "v " but not "vt " or "vn "
+		inline bool isKeyword(const char* p, const char* end, char keyword)
+		{
+			return end - p >= 2 && p[0] == keyword && isBlank(p[1]);
+		}
+
+		// Within 1 ulp of the correctly rounded float for the up to 19 significant digits OBJ exporters write,
+		// the double intermediate rounds once above 2^53 and again when scaling, no locale and no allocation
+		bool parseFloat(const char*& p, const char* end, float& value)
+		{
+			static constexpr double POWERS_OF_TEN[] = {
+				1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+				1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+			};
+
+			const char* start = p;
+			bool negative = false;
+			if (p < end && (*p == '-' || *p == '+')) {
+				negative = *p == '-';
+				p++;
+			}
+
+			uint64_t mantissa = 0;
+			int exponent = 0;
+			int digits = 0;
+			bool any = false;
+
+			for (; p < end && isDigit(*p); p++, any = true) {
+				if (digits < 19) {
+					mantissa = mantissa * 10 + (*p - '0');
+					if (mantissa) digits++;
+				}
+				else {
+					exponent++;
+				}
+			}
+
+			if (p < end && *p == '.') {
+				p++;
+				for (; p < end && isDigit(*p); p++, any = true) {
+					if (digits < 19) {
+						mantissa = mantissa * 10 + (*p - '0');
+						if (mantissa) digits++;
+						exponent--;
+					}
+				}
+			}
+
+			if (!any) {
+				p = start;
+				return false;
+			}
+
+			if (p < end && (*p == 'e' || *p == 'E')) {
+				const char* exponentStart = p++;
+				bool negativeExponent = false;
+				if (p < end && (*p == '-' || *p == '+')) {
+					negativeExponent = *p == '-';
+					p++;
+				}
+
+				if (p < end && isDigit(*p)) {
+					int explicitExponent = 0;
+					for (; p < end && isDigit(*p); p++) {
+						if (explicitExponent < 10000) explicitExponent = explicitExponent * 10 + (*p - '0');
+					}
+					exponent += negativeExponent ? -explicitExponent : explicitExponent;
+				}
+				else {
+					// Not an exponent after all, like "1e"
+					p = exponentStart;
+				}
+			}
+
+			double result = static_cast<double>(mantissa);
+			if (exponent < 0) {
+				result = -exponent <= 22 ? result / POWERS_OF_TEN[-exponent] : result * std::pow(10.0, exponent);
+			}
+			else if (exponent > 0) {
+				result = exponent <= 22 ? result * POWERS_OF_TEN[exponent] : result * std::pow(10.0, exponent);
+			}
+
+			value = static_cast<float>(negative ? -result : result);
+			return true;
+		}
+
+		bool parseInt(const char*& p, const char* end, int64_t& value)
+		{
+			const char* start = p;
+			bool negative = false;
+			if (p < end && (*p == '-' || *p == '+')) {
+				negative = *p == '-';
+				p++;
+			}
+
+			if (p >= end || !isDigit(*p)) {
+				p = start;
+				return false;
+			}
+
+			int64_t result = 0;
+			for (; p < end && isDigit(*p); p++) {
+				if (result < (int64_t(1) << 40)) result = result * 10 + (*p - '0');
+			}
+
+			value = negative ? -result : result;
+			return true;
+		}
+
+		void countChunk(Chunk& chunk)
+		{
+			const char* p = chunk.begin;
+			const char* end = chunk.end;
+
+			while (p < end) {
+				skipBlanks(p, end);
+
+				if (isKeyword(p, end, 'v')) {
+					chunk.positionCount++;
+				}
+				else if (isKeyword(p, end, 'f')) {
+					p += 2;
+
+					uint32_t corners = 0;
+					for (;;) {
+						skipBlanks(p, end);
+						if (p >= end || *p == '\n' || *p == '#') break;
+						skipToken(p, end);
+						corners++;
+					}
+
+					if (corners >= 3) {
+						chunk.indexCount += 3 * static_cast<size_t>(corners - 2);
+					}
+				}
+
+				skipLine(p, end);
+			}
+		}
+
+		// Positions are written at firstPosition and indices at firstIndex, both from the counting pass
+		void parseChunk(const Chunk& chunk, SdeModel::Vertex* positions, uint32_t totalPositions, uint32_t* indices)
+		{
+			const char* p = chunk.begin;
+			const char* end = chunk.end;
+
+			uint32_t position = chunk.firstPosition;
+			uint32_t* index = indices + chunk.firstIndex;
+
+			while (p < end) {
+				skipBlanks(p, end);
+
+				if (isKeyword(p, end, 'v')) {
+					p += 2;
+
+					// x y z, x y z w, x y z r g b or x y z w r g b
+					float values[7];
+					uint32_t count = 0;
+					for (; count < 7; count++) {
+						skipBlanks(p, end);
+						if (!parseFloat(p, end, values[count])) break;
+					}
+
+					if (count < 3) {
+						throw std::runtime_error("Invalid vertex position in model file");
+					}
+
+					auto& vertex = positions[position++];
+					vertex.pos = { values[0], values[1], values[2] };
+					if (count >= 6) {
+						uint32_t first = count == 7 ? 4 : 3;
+						vertex.color = { values[first], values[first + 1], values[first + 2] };
+					}
+					else {
+						vertex.color = { 1.0f, 1.0f, 1.0f };
+					}
+				}
+				else if (isKeyword(p, end, 'f')) {
+					p += 2;
+
+					uint32_t first = 0;
+					uint32_t previous = 0;
+					uint32_t corners = 0;
+					for (;; corners++) {
+						skipBlanks(p, end);
+						if (p >= end || *p == '\n' || *p == '#') break;
+
+						// Only the position of v/vt/vn is kept
+						int64_t value = 0;
+						if (!parseInt(p, end, value)) {
+							throw std::runtime_error("Invalid face in model file");
+						}
+						skipToken(p, end);
+
+						// Negative indices count back from the last position defined before the face
+						int64_t resolved = value > 0 ? value - 1 : static_cast<int64_t>(position) + value;
+						if (value == 0 || resolved < 0 || resolved >= totalPositions) {
+							throw std::runtime_error("Face index out of range in model file");
+						}
+
+						uint32_t current = static_cast<uint32_t>(resolved);
+						if (corners == 0) {
+							first = current;
+						}
+						else if (corners >= 2) {
+							index[0] = first;
+							index[1] = previous;
+							index[2] = current;
+							index += 3;
+						}
+						previous = current;
+					}
+				}
+
+				skipLine(p, end);
+			}
+		}
+
+		inline uint64_t hashVertex(const SdeModel::Vertex& vertex)
+		{
+			uint32_t words[6];
+			std::memcpy(words, &vertex, sizeof(words));
+
+			uint64_t hash = 0x9E3779B97F4A7C15ull;
+			for (uint32_t word : words) {
+				hash = (hash ^ word) * 0xBF58476D1CE4E5B9ull;
+				hash ^= hash >> 31;
+			}
+			return hash;
+		}
+
+		// Compacts positions to the distinct vertices in place and returns the new index of every old one.
+		// Open addressing with linear probing, the table holds index + 1 so zero marks a free slot.
+		std::vector<uint32_t> deduplicate(std::vector<SdeModel::Vertex>& positions)
+		{
+			static_assert(sizeof(SdeModel::Vertex) == 6 * sizeof(float), "hashVertex expects a tightly packed position and color");
+
+			size_t capacity = 16;
+			while (capacity < positions.size() * 2) capacity <<= 1;
+			size_t mask = capacity - 1;
+
+			std::vector<uint32_t> table(capacity, 0);
+			std::vector<uint32_t> remap(positions.size());
+			uint32_t uniqueCount = 0;
+
+			for (size_t i = 0; i < positions.size(); i++) {
+				const auto& vertex = positions[i];
+				size_t slot = hashVertex(vertex) & mask;
+
+				for (;;) {
+					uint32_t entry = table[slot];
+					if (entry == 0) {
+						positions[uniqueCount] = vertex;
+						table[slot] = ++uniqueCount;
+						remap[i] = uniqueCount - 1;
+						break;
+					}
+					if (std::memcmp(&positions[entry - 1], &vertex, sizeof(vertex)) == 0) {
+						remap[i] = entry - 1;
+						break;
+					}
+					slot = (slot + 1) & mask;
+				}
+			}
+
+			positions.resize(uniqueCount);
+			return remap;
+		}
+
+	}
+
+	void SdeObjLoader::load(const std::string& path, std::vector<SdeModel::Vertex>& vertices, std::vector<uint32_t>& indices, SdeJobSystem* jobSystem)
+	{
+		SDE_TRACE_FUNCTION();
+
+		MappedFile file(path);
+		const char* data = file.data();
+		const char* dataEnd = data + file.size();
+
+		// Split into chunks of whole lines
+		uint32_t chunkCount = jobSystem ? jobSystem->getThreadCount() * CHUNKS_PER_THREAD : 1;
+		chunkCount = static_cast<uint32_t>(std::max<size_t>(1, std::min<size_t>(chunkCount, file.size() / MIN_CHUNK_SIZE)));
+
+		std::vector<Chunk> chunks;
+		chunks.reserve(chunkCount);
+
+		const char* chunkBegin = data;
+		for (uint32_t i = 0; i < chunkCount && chunkBegin < dataEnd; i++) {
+			const char* chunkEnd = i + 1 == chunkCount ? dataEnd : std::max(chunkBegin, data + file.size() / chunkCount * (i + 1));
+			if (chunkEnd < dataEnd) skipLine(chunkEnd, dataEnd);
+
+			Chunk chunk = {};
+			chunk.begin = chunkBegin;
+			chunk.end = chunkEnd;
+			chunks.push_back(chunk);
+
+			chunkBegin = chunkEnd;
+		}
+
+		auto forEachChunk = [&](auto function) {
+			if (!jobSystem || chunks.size() == 1) {
+				for (auto& chunk : chunks) function(chunk);
+				return;
+			}
+
+			SdeJobCounter counter;
+			for (auto& chunk : chunks) {
+				jobSystem->run([&function, &chunk]() { function(chunk); }, &counter);
+			}
+			jobSystem->wait(counter);
+		};
+
+		{
+			SDE_TRACE_ZONE("Count");
+			forEachChunk([](Chunk& chunk) { countChunk(chunk); });
+		}
+
+		// Every chunk owns a contiguous slice of the positions and indices
+		uint64_t totalPositions = 0;
+		size_t totalIndices = 0;
+		for (auto& chunk : chunks) {
+			chunk.firstPosition = static_cast<uint32_t>(totalPositions);
+			chunk.firstIndex = totalIndices;
+			totalPositions += chunk.positionCount;
+			totalIndices += chunk.indexCount;
+		}
+
+		if (totalPositions > std::numeric_limits<uint32_t>::max() || totalIndices > std::numeric_limits<uint32_t>::max()) {
+			throw std::runtime_error("Model file exceeds 32 bit indices: " + path);
+		}
+
+		std::vector<SdeModel::Vertex> positions(static_cast<size_t>(totalPositions));
+		indices.resize(totalIndices);
+
+		{
+			SDE_TRACE_ZONE("Parse");
+			forEachChunk([&](Chunk& chunk) { parseChunk(chunk, positions.data(), static_cast<uint32_t>(totalPositions), indices.data()); });
+		}
+
+		std::vector<uint32_t> remap;
+		{
+			SDE_TRACE_ZONE("Deduplicate");
+			remap = deduplicate(positions);
+		}
+
+		{
+			SDE_TRACE_ZONE("Remap");
+			forEachChunk([&](Chunk& chunk) {
+				uint32_t* index = indices.data() + chunk.firstIndex;
+				for (size_t i = 0; i < chunk.indexCount; i++) {
+					index[i] = remap[index[i]];
+				}
+			});
+		}
+
+		vertices = std::move(positions);
+	}
+
+}
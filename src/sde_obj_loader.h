@@ -0,0 +1,27 @@
+#pragma once
+
+#include "sde_model.h"
+#include "sde_job_system.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace sde {
+
+	// Wavefront OBJ geometry importer. The file is memory mapped and parsed in chunks of whole lines,
+	// in parallel when a job system is given, without allocating per line. Only positions and the
+	// optional per vertex colors ("v x y z r g b") are kept, faces are triangulated as fans and
+	// vertices with equal position and color are merged.
+	class SdeObjLoader {
+	public:
+		// Files smaller than this are parsed by a single job
+		static constexpr size_t MIN_CHUNK_SIZE = 256 * 1024;
+		// Chunks per thread, evens out chunks that hold more faces than others
+		static constexpr uint32_t CHUNKS_PER_THREAD = 4;
+
+		// Replaces the contents of vertices and indices, throws on unreadable files or invalid faces
+		static void load(const std::string& path, std::vector<SdeModel::Vertex>& vertices, std::vector<uint32_t>& indices, SdeJobSystem* jobSystem = nullptr);
+	};
+
+}
@@ -0,0 +1,110 @@
+#include "sde_parallel_recorder.h"
+#include "sde_trace.h"
+
+#include <algorithm>
+
+namespace sde {
+
+	SdeParallelRecorder::SdeParallelRecorder(SdeDevice& device, uint32_t framesInFlight, SdeJobSystem* jobSystem)
+		: m_Device(device), m_JobSystem(jobSystem), m_FramesInFlight(framesInFlight), m_ChunkCount(jobSystem ? jobSystem->getThreadCount() : 1)
+	{
+		vk::CommandPoolCreateInfo poolInfo = {};
+		poolInfo.flags = vk::CommandPoolCreateFlagBits::eTransient;
+		poolInfo.queueFamilyIndex = m_Device.findPhysicalQueueFamilies().graphicsFamily.value();
+
+		m_ChunkFrames.resize(m_ChunkCount * m_FramesInFlight);
+		for (auto& chunkFrame : m_ChunkFrames) {
+			chunkFrame.commandPool = m_Device.device().createCommandPool(poolInfo);
+		}
+	}
+
+	SdeParallelRecorder::~SdeParallelRecorder()
+	{
+		// Destroying a pool frees its command buffers
+		for (auto& chunkFrame : m_ChunkFrames) {
+			m_Device.device().destroyCommandPool(chunkFrame.commandPool);
+		}
+	}
+
+	void SdeParallelRecorder::beginFrame(int frameIndex)
+	{
+		SDE_TRACE_FUNCTION();
+
+		m_FrameIndex = frameIndex;
+		for (uint32_t chunk = 0; chunk < m_ChunkCount; chunk++) {
+			auto& chunkFrame = m_ChunkFrames[chunk * m_FramesInFlight + frameIndex];
+			m_Device.device().resetCommandPool(chunkFrame.commandPool);
+			chunkFrame.usedCount = 0;
+		}
+	}
+
+	std::vector<vk::CommandBuffer> SdeParallelRecorder::record(const vk::CommandBufferInheritanceInfo& inheritance, uint32_t itemCount, const SdeRecordFunction& recordRange)
+	{
+		SDE_TRACE_FUNCTION();
+
+		if (itemCount == 0) return {};
+
+		uint32_t usefulChunks = (itemCount + MIN_ITEMS_PER_JOB - 1) / MIN_ITEMS_PER_JOB;
+		uint32_t chunkCount = std::min(m_ChunkCount, usefulChunks);
+		std::vector<vk::CommandBuffer> results(chunkCount);
+
+		auto chunkBegin = [&](uint32_t chunk) {
+			return static_cast<uint32_t>(static_cast<uint64_t>(itemCount) * chunk / chunkCount);
+		};
+
+		SdeJobCounter counter;
+		for (uint32_t chunk = 1; chunk < chunkCount; chunk++) {
+			m_JobSystem->run([&, chunk]() {
+				results[chunk] = recordChunk(chunk, chunkBegin(chunk), chunkBegin(chunk + 1), inheritance, recordRange);
+			}, &counter);
+		}
+
+		// The jobs reference this frame, they must be done before an exception leaves it
+		std::exception_ptr error;
+		try {
+			results[0] = recordChunk(0, 0, chunkBegin(1), inheritance, recordRange);
+		}
+		catch (...) {
+			error = std::current_exception();
+		}
+
+		if (m_JobSystem) {
+			m_JobSystem->wait(counter);
+		}
+		if (error) {
+			std::rethrow_exception(error);
+		}
+
+		return results;
+	}
+
+	vk::CommandBuffer SdeParallelRecorder::recordChunk(uint32_t chunk, uint32_t begin, uint32_t end, const vk::CommandBufferInheritanceInfo& inheritance, const SdeRecordFunction& recordRange)
+	{
+		SDE_TRACE_FUNCTION();
+
+		// Chunk slots are never recorded concurrently, so each pool is used by one thread at a time
+		auto& chunkFrame = m_ChunkFrames[chunk * m_FramesInFlight + m_FrameIndex];
+
+		// Buffers are kept across frames, the pool reset only rewinds them
+		if (chunkFrame.usedCount == chunkFrame.commandBuffers.size()) {
+			vk::CommandBufferAllocateInfo allocInfo = {};
+			allocInfo.commandPool = chunkFrame.commandPool;
+			allocInfo.level = vk::CommandBufferLevel::eSecondary;
+			allocInfo.commandBufferCount = 1;
+
+			chunkFrame.commandBuffers.push_back(m_Device.device().allocateCommandBuffers(allocInfo)[0]);
+		}
+		auto commandBuffer = chunkFrame.commandBuffers[chunkFrame.usedCount++];
+
+		vk::CommandBufferBeginInfo beginInfo = {};
+		beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue;
+		beginInfo.pInheritanceInfo = &inheritance;
+
+		commandBuffer.begin(beginInfo);
+		recordRange(commandBuffer, begin, end);
+		commandBuffer.end();
+
+		return commandBuffer;
+	}
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "sde_device.h"
+#include "sde_job_system.h"
+
+#include <vulkan/vulkan.hpp>
+#include <functional>
+#include <vector>
+
+namespace sde {
+
+	// Records draws [begin, end) into a secondary command buffer, called from several threads at once
+	using SdeRecordFunction = std::function<void(vk::CommandBuffer commandBuffer, uint32_t begin, uint32_t end)>;
+
+	// Splits draw recording into jobs. Every chunk slot has a command pool per frame in flight and
+	// is recorded by one job at a time, so recording never locks and a frame's pools are reset
+	// as a whole once its fence signaled.
+	class SdeParallelRecorder {
+	public:
+		// Fewer draws than this per job are not worth the hand off
+		static constexpr uint32_t MIN_ITEMS_PER_JOB = 256;
+
+		// Null jobSystem records everything on the calling thread
+		SdeParallelRecorder(SdeDevice& device, uint32_t framesInFlight, SdeJobSystem* jobSystem);
+		~SdeParallelRecorder();
+
+		SdeParallelRecorder(const SdeParallelRecorder&) = delete;
+		SdeParallelRecorder& operator=(const SdeParallelRecorder&) = delete;
+
+		// Resets the pools of frameIndex, its fence must have signaled
+		void beginFrame(int frameIndex);
+
+		// Records itemCount items into secondaries continuing inheritance.renderPass.
+		// Returns them in item order, to be passed to executeCommands.
+		std::vector<vk::CommandBuffer> record(const vk::CommandBufferInheritanceInfo& inheritance, uint32_t itemCount, const SdeRecordFunction& recordRange);
+
+		uint32_t getChunkCount() const { return m_ChunkCount; }
+
+	private:
+		struct ChunkFrame {
+			vk::CommandPool commandPool;
+			std::vector<vk::CommandBuffer> commandBuffers;
+			uint32_t usedCount = 0;
+		};
+
+		vk::CommandBuffer recordChunk(uint32_t chunk, uint32_t begin, uint32_t end, const vk::CommandBufferInheritanceInfo& inheritance, const SdeRecordFunction& recordRange);
+
+	private:
+		SdeDevice& m_Device;
+		SdeJobSystem* m_JobSystem;
+		uint32_t m_FramesInFlight;
+		uint32_t m_ChunkCount;
+		int m_FrameIndex = 0;
+
+		// Indexed by chunk * framesInFlight + frame
+		std::vector<ChunkFrame> m_ChunkFrames;
+	};
+
+}
@@ -1,48 +1,148 @@
 #include "sde_pipeline.h"
+#include "sde_trace.h"
+#include "sde_deletion_queue.h"
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 
 namespace sde {
+	SdeSpecializationConstants& SdeSpecializationConstants::setUint(uint32_t constantId, uint32_t value)
+	{
+		setBits(constantId, value);
+		return *this;
+	}
+
+	SdeSpecializationConstants& SdeSpecializationConstants::setInt(uint32_t constantId, int32_t value)
+	{
+		setBits(constantId, static_cast<uint32_t>(value));
+		return *this;
+	}
+
+	SdeSpecializationConstants& SdeSpecializationConstants::setFloat(uint32_t constantId, float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		setBits(constantId, bits);
+		return *this;
+	}
+
+	SdeSpecializationConstants& SdeSpecializationConstants::setBool(uint32_t constantId, bool value)
+	{
+		setBits(constantId, value ? VK_TRUE : VK_FALSE);
+		return *this;
+	}
+
+	SdeSpecializationConstants& SdeSpecializationConstants::merge(const SdeSpecializationConstants& other)
+	{
+		for (const auto& entry : other.m_Entries) {
+			setBits(entry.constantID, other.getBits(entry));
+		}
+		return *this;
+	}
+
+	vk::SpecializationInfo SdeSpecializationConstants::getInfo() const
+	{
+		vk::SpecializationInfo info = {};
+		info.mapEntryCount = static_cast<uint32_t>(m_Entries.size());
+		info.pMapEntries = m_Entries.data();
+		info.dataSize = m_Data.size() * sizeof(uint32_t);
+		info.pData = m_Data.data();
+		return info;
+	}
+
+	void SdeSpecializationConstants::setBits(uint32_t constantId, uint32_t bits)
+	{
+		auto it = std::lower_bound(m_Entries.begin(), m_Entries.end(), constantId,
+			[](const vk::SpecializationMapEntry& entry, uint32_t id) { return entry.constantID < id; });
+
+		if (it != m_Entries.end() && it->constantID == constantId) {
+			m_Data[it->offset / sizeof(uint32_t)] = bits;
+			return;
+		}
+
+		uint32_t offset = static_cast<uint32_t>(m_Data.size() * sizeof(uint32_t));
+		m_Entries.insert(it, vk::SpecializationMapEntry(constantId, offset, sizeof(uint32_t)));
+		m_Data.push_back(bits);
+	}
+
+	SdePipeline::SdePipeline(
+		SdeDevice& device,
+		SdeShaderCode vertexCode,
+		SdeShaderCode fragmentCode,
+		const PipelineConfigInfo& configInfo) : m_Device(device)
+	{
+		createGraphicsPipeline(vertexCode, fragmentCode, configInfo);
+	}
+
 	SdePipeline::SdePipeline(
 		SdeDevice& device, 
 		const std::string& vertexPath, 
 		const std::string& fragmentPath, 
 		const PipelineConfigInfo& configInfo) : m_Device(device)
 	{
-		createGraphicsPipeline(vertexPath, fragmentPath, configInfo);
+		auto vertexCode = readFile(vertexPath);
+		auto fragmentCode = readFile(fragmentPath);
+
+		createGraphicsPipeline(
+			{ vertexCode.data(), vertexCode.size() * sizeof(uint32_t) },
+			{ fragmentCode.data(), fragmentCode.size() * sizeof(uint32_t) },
+			configInfo);
+	}
+
+	SdePipeline::SdePipeline(SdeDevice& device, SdeShaderCode computeCode, vk::PipelineLayout pipelineLayout, const SdeSpecializationConstants& specialization)
+		: m_Device(device), m_BindPoint(vk::PipelineBindPoint::eCompute)
+	{
+		createComputePipeline(computeCode, pipelineLayout, specialization);
+	}
+
+	SdePipeline::SdePipeline(SdeDevice& device, const std::string& computePath, vk::PipelineLayout pipelineLayout, const SdeSpecializationConstants& specialization)
+		: m_Device(device), m_BindPoint(vk::PipelineBindPoint::eCompute)
+	{
+		auto computeCode = readFile(computePath);
+		createComputePipeline({ computeCode.data(), computeCode.size() * sizeof(uint32_t) }, pipelineLayout, specialization);
 	}
 
 	SdePipeline::~SdePipeline()
 	{
-		m_Device.device().destroyPipeline(m_Pipeline);
+		// Shader modules are only needed for creation and go right away
+		vk::Device device = m_Device.device();
+		vk::Pipeline pipeline = m_Pipeline;
+		m_Device.deletionQueue().push([device, pipeline]() {
+			device.destroyPipeline(pipeline);
+		});
 	}
 
 	void SdePipeline::bind(vk::CommandBuffer commandBuffer)
 	{
-		commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_Pipeline);
+		commandBuffer.bindPipeline(m_BindPoint, m_Pipeline);
 	}
 
-	void SdePipeline::createGraphicsPipeline(const std::string& vertexPath, const std::string& fragmentPath, const PipelineConfigInfo& configInfo)
+	void SdePipeline::createGraphicsPipeline(SdeShaderCode vertexCode, SdeShaderCode fragmentCode, const PipelineConfigInfo& configInfo)
 	{
-		auto vertexCode = readFile(vertexPath);
-		auto fragmentCode = readFile(fragmentPath);
+		SDE_TRACE_FUNCTION();
 
 		m_VertexShaderModule = createShaderModule(vertexCode);
 		m_FragmentShaderModule = createShaderModule(fragmentCode);
 
+		vk::SpecializationInfo specializationInfo = configInfo.specialization.getInfo();
+		const vk::SpecializationInfo* pSpecializationInfo = configInfo.specialization.empty() ? nullptr : &specializationInfo;
+
 		vk::PipelineShaderStageCreateInfo shaderStages[] = {
 			{
 				vk::PipelineShaderStageCreateFlags(),
 				vk::ShaderStageFlagBits::eVertex,
 				m_VertexShaderModule.get(),
-				"main"
+				"main",
+				pSpecializationInfo
 			},
 			{
 				vk::PipelineShaderStageCreateFlags(),
 				vk::ShaderStageFlagBits::eFragment,
 				m_FragmentShaderModule.get(),
-				"main"
+				"main",
+				pSpecializationInfo
 			}
 		};
 
@@ -50,7 +150,7 @@ namespace sde {
 		auto& attributeDescriptions = configInfo.attributeDescriptions;
 
 		vk::PipelineVertexInputStateCreateInfo vertexInputInfo = {};
-		vertexInputInfo.vertexBindingDescriptionCount = 1;
+		vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescription.size());
 		vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
 		vertexInputInfo.pVertexBindingDescriptions = bindingDescription.data();
 		vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
@@ -64,7 +164,7 @@ namespace sde {
 		pipelineInfo.pViewportState = &configInfo.viewportInfo;
 		pipelineInfo.pRasterizationState = &configInfo.rasterizationInfo;
 		pipelineInfo.pMultisampleState = &configInfo.multisampleInfo;
-		pipelineInfo.pDepthStencilState = nullptr; // Optional
+		pipelineInfo.pDepthStencilState = &configInfo.depthStencilInfo;
 		pipelineInfo.pColorBlendState = &configInfo.colorBlendInfo;
 		pipelineInfo.pDynamicState = &configInfo.dynamicStateInfo;
 
@@ -76,7 +176,7 @@ namespace sde {
 		pipelineInfo.basePipelineIndex = -1;
 
 		try {
-			auto pipilineVkResult = m_Device.device().createGraphicsPipeline(nullptr, pipelineInfo);
+			auto pipilineVkResult = m_Device.device().createGraphicsPipeline(m_Device.pipelineCache(), pipelineInfo);
 			if (pipilineVkResult.result != vk::Result::eSuccess)
 				throw new std::runtime_error("Failed to create graphics pipeline");
 
@@ -87,11 +187,33 @@ namespace sde {
 		}
 	}
 
-	vk::UniqueShaderModule SdePipeline::createShaderModule(const std::vector<char>& shaderCode)
+	void SdePipeline::createComputePipeline(SdeShaderCode computeCode, vk::PipelineLayout pipelineLayout, const SdeSpecializationConstants& specialization)
+	{
+		SDE_TRACE_FUNCTION();
+
+		m_ComputeShaderModule = createShaderModule(computeCode);
+
+		vk::SpecializationInfo specializationInfo = specialization.getInfo();
+
+		vk::ComputePipelineCreateInfo pipelineInfo = {};
+		pipelineInfo.stage.stage = vk::ShaderStageFlagBits::eCompute;
+		pipelineInfo.stage.module = m_ComputeShaderModule.get();
+		pipelineInfo.stage.pName = "main";
+		pipelineInfo.stage.pSpecializationInfo = specialization.empty() ? nullptr : &specializationInfo;
+		pipelineInfo.layout = pipelineLayout;
+
+		auto pipelineVkResult = m_Device.device().createComputePipeline(m_Device.pipelineCache(), pipelineInfo);
+		if (pipelineVkResult.result != vk::Result::eSuccess)
+			throw std::runtime_error("Failed to create compute pipeline");
+
+		m_Pipeline = pipelineVkResult.value;
+	}
+
+	vk::UniqueShaderModule SdePipeline::createShaderModule(SdeShaderCode shaderCode)
 	{
 		vk::ShaderModuleCreateInfo createInfo = {};
-		createInfo.codeSize = shaderCode.size();
-		createInfo.pCode = reinterpret_cast<const uint32_t*>(shaderCode.data());
+		createInfo.codeSize = shaderCode.size;
+		createInfo.pCode = shaderCode.code;
 
 		return m_Device.device().createShaderModuleUnique(createInfo);
 	}
@@ -136,6 +258,14 @@ namespace sde {
 		configInfo.colorBlendInfo.blendConstants[2] = 0.0f;  // Optional
 		configInfo.colorBlendInfo.blendConstants[3] = 0.0f;  // Optional
 
+		configInfo.depthStencilInfo.depthTestEnable = VK_FALSE;
+		configInfo.depthStencilInfo.depthWriteEnable = VK_FALSE;
+		configInfo.depthStencilInfo.depthCompareOp = vk::CompareOp::eLess;
+		configInfo.depthStencilInfo.depthBoundsTestEnable = VK_FALSE;
+		configInfo.depthStencilInfo.minDepthBounds = 0.0f;  // Optional
+		configInfo.depthStencilInfo.maxDepthBounds = 1.0f;  // Optional
+		configInfo.depthStencilInfo.stencilTestEnable = VK_FALSE;
+
 		configInfo.dynamicStateEnables = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
 		configInfo.dynamicStateInfo.pDynamicStates = configInfo.dynamicStateEnables.data();
 		configInfo.dynamicStateInfo.dynamicStateCount =
@@ -145,6 +275,37 @@ namespace sde {
 		configInfo.attributeDescriptions = SdeModel::Vertex::getAttributeDescriptions();
 	}
 
+	void SdePipeline::instancedPipelineConfigInfo(PipelineConfigInfo& configInfo)
+	{
+		defaultPipelineConfigInfo(configInfo);
+
+		configInfo.bindingDescriptions.push_back(SdeModel::InstanceData::getBindingDescription());
+		auto instanceAttributes = SdeModel::InstanceData::getAttributeDescriptions();
+		configInfo.attributeDescriptions.insert(configInfo.attributeDescriptions.end(), instanceAttributes.begin(), instanceAttributes.end());
+	}
+
+	void SdePipeline::copyPipelineConfigInfo(const PipelineConfigInfo& source, PipelineConfigInfo& destination)
+	{
+		destination.bindingDescriptions = source.bindingDescriptions;
+		destination.attributeDescriptions = source.attributeDescriptions;
+		destination.viewportInfo = source.viewportInfo;
+		destination.inputAssemblyInfo = source.inputAssemblyInfo;
+		destination.rasterizationInfo = source.rasterizationInfo;
+		destination.multisampleInfo = source.multisampleInfo;
+		destination.colorBlendAttachment = source.colorBlendAttachment;
+		destination.colorBlendInfo = source.colorBlendInfo;
+		destination.dynamicStateEnables = source.dynamicStateEnables;
+		destination.dynamicStateInfo = source.dynamicStateInfo;
+		destination.pipelineLayout = source.pipelineLayout;
+		destination.renderPass = source.renderPass;
+		destination.subpass = source.subpass;
+		destination.specialization = source.specialization;
+
+		destination.colorBlendInfo.pAttachments = &destination.colorBlendAttachment;
+		destination.dynamicStateInfo.pDynamicStates = destination.dynamicStateEnables.data();
+		destination.dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(destination.dynamicStateEnables.size());
+	}
+
 	void SdePipeline::enableAlphaBlending(PipelineConfigInfo& configInfo)
 	{
 		configInfo.colorBlendAttachment.blendEnable = VK_TRUE;
@@ -157,18 +318,21 @@ namespace sde {
 		configInfo.colorBlendAttachment.alphaBlendOp = vk::BlendOp::eAdd;
 	}
 
-	std::vector<char> SdePipeline::readFile(const std::string& path)
+	std::vector<uint32_t> SdePipeline::readFile(const std::string& path)
 	{
 		std::ifstream file(path, std::ios::ate | std::ios::binary);
 
 		if (!file.is_open())
-			throw new std::runtime_error("Failed to open shader file: " + path);
+			throw std::runtime_error("Failed to open shader file: " + path);
 
 		size_t fileSize = static_cast<size_t>(file.tellg());
-		std::vector<char> buffer(fileSize);
+		if (fileSize == 0 || fileSize % sizeof(uint32_t) != 0)
+			throw std::runtime_error("Not a SPIR-V file: " + path);
+
+		std::vector<uint32_t> buffer(fileSize / sizeof(uint32_t));
 
 		file.seekg(0);
-		file.read(buffer.data(), fileSize);
+		file.read(reinterpret_cast<char*>(buffer.data()), fileSize);
 
 		file.close();
 		return buffer;
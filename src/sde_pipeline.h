@@ -9,6 +9,46 @@
 
 namespace sde {
 
+	// Non owning view of SPIR-V words, usually an embedded array from sde_shaders.h
+	struct SdeShaderCode {
+		const uint32_t* code = nullptr;
+		size_t size = 0; // In bytes
+
+		SdeShaderCode() = default;
+		SdeShaderCode(const uint32_t* code, size_t size) : code(code), size(size) {}
+
+		template<size_t N>
+		SdeShaderCode(const uint32_t(&words)[N]) : code(words), size(N * sizeof(uint32_t)) {}
+	};
+
+	// Values for layout(constant_id = N) constants, applied to every stage of a pipeline.
+	// Stages that do not declare a constant ignore it. Booleans are stored as VkBool32.
+	class SdeSpecializationConstants {
+	public:
+		// Named per type, overloads made calls with plain literals ambiguous
+		SdeSpecializationConstants& setUint(uint32_t constantId, uint32_t value);
+		SdeSpecializationConstants& setInt(uint32_t constantId, int32_t value);
+		SdeSpecializationConstants& setFloat(uint32_t constantId, float value);
+		SdeSpecializationConstants& setBool(uint32_t constantId, bool value);
+		// Overrides the constants that are also set in other
+		SdeSpecializationConstants& merge(const SdeSpecializationConstants& other);
+
+		bool empty() const { return m_Entries.empty(); }
+		// Points into this object, valid until it is modified or destroyed
+		vk::SpecializationInfo getInfo() const;
+
+		// Sorted by constantID so equal sets compare equal
+		const std::vector<vk::SpecializationMapEntry>& getEntries() const { return m_Entries; }
+		uint32_t getBits(const vk::SpecializationMapEntry& entry) const { return m_Data[entry.offset / sizeof(uint32_t)]; }
+
+	private:
+		void setBits(uint32_t constantId, uint32_t bits);
+
+	private:
+		std::vector<vk::SpecializationMapEntry> m_Entries;
+		std::vector<uint32_t> m_Data;
+	};
+
 	struct PipelineConfigInfo {
 		PipelineConfigInfo() = default;
 		PipelineConfigInfo(const PipelineConfigInfo&) = delete;
@@ -22,16 +62,23 @@ namespace sde {
 		vk::PipelineMultisampleStateCreateInfo multisampleInfo;
 		vk::PipelineColorBlendAttachmentState colorBlendAttachment;
 		vk::PipelineColorBlendStateCreateInfo colorBlendInfo;
+		// Ignored while the render pass has no depth attachment
+		vk::PipelineDepthStencilStateCreateInfo depthStencilInfo;
 		std::vector<vk::DynamicState> dynamicStateEnables;
 		vk::PipelineDynamicStateCreateInfo dynamicStateInfo;
 		vk::PipelineLayout pipelineLayout = nullptr;
 		vk::RenderPass renderPass = nullptr;
 		uint32_t subpass = 0;
+		SdeSpecializationConstants specialization;
 	};
 
 	class SdePipeline {
 	public:
+		SdePipeline(SdeDevice& device, SdeShaderCode vertexCode, SdeShaderCode fragmentCode, const PipelineConfigInfo& configInfo);
 		SdePipeline(SdeDevice& device, const std::string& vertexPath, const std::string& fragmentPath, const PipelineConfigInfo& configInfo);
+		// Compute pipeline
+		SdePipeline(SdeDevice& device, SdeShaderCode computeCode, vk::PipelineLayout pipelineLayout, const SdeSpecializationConstants& specialization = {});
+		SdePipeline(SdeDevice& device, const std::string& computePath, vk::PipelineLayout pipelineLayout, const SdeSpecializationConstants& specialization = {});
 		~SdePipeline();
 
 		SdePipeline(const SdePipeline&) = delete;
@@ -39,17 +86,24 @@ namespace sde {
 
 		void bind(vk::CommandBuffer commandBuffer);
 		static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
+		// Default config plus the SdeModel::InstanceData binding, for drawInstanced
+		static void instancedPipelineConfigInfo(PipelineConfigInfo& configInfo);
 		static void enableAlphaBlending(PipelineConfigInfo& configInfo);
+		// PipelineConfigInfo points into itself, copies need those pointers redirected
+		static void copyPipelineConfigInfo(const PipelineConfigInfo& source, PipelineConfigInfo& destination);
 
-	private:
-		void createGraphicsPipeline(const std::string& vertexPath, const std::string& fragmentPath, const PipelineConfigInfo& configInfo);
-		vk::UniqueShaderModule createShaderModule(const std::vector<char>& shaderCode);
+		// Words of a .spv file, for shaders that are not embedded
+		static std::vector<uint32_t> readFile(const std::string& path);
 
-		static std::vector<char> readFile(const std::string& path);
+	private:
+		void createGraphicsPipeline(SdeShaderCode vertexCode, SdeShaderCode fragmentCode, const PipelineConfigInfo& configInfo);
+		void createComputePipeline(SdeShaderCode computeCode, vk::PipelineLayout pipelineLayout, const SdeSpecializationConstants& specialization);
+		vk::UniqueShaderModule createShaderModule(SdeShaderCode shaderCode);
 
 	private:
 		SdeDevice& m_Device;
 		vk::Pipeline m_Pipeline;
-		vk::UniqueShaderModule m_VertexShaderModule, m_FragmentShaderModule;
+		vk::PipelineBindPoint m_BindPoint = vk::PipelineBindPoint::eGraphics;
+		vk::UniqueShaderModule m_VertexShaderModule, m_FragmentShaderModule, m_ComputeShaderModule;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,452 @@
+#include "sde_pipeline_registry.h"
+#include "sde_trace.h"
+#include "sde_deletion_queue.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace sde {
+
+	template<typename T>
+	static uint64_t handleBits(T handle)
+	{
+		return (uint64_t)(static_cast<typename T::CType>(handle));
+	}
+
+	static uint64_t floatBits(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	static void appendString(std::vector<uint64_t>& key, const std::string& value)
+	{
+		key.push_back(value.size());
+		for (size_t i = 0; i < value.size(); i += 8) {
+			uint64_t word = 0;
+			memcpy(&word, value.data() + i, std::min<size_t>(8, value.size() - i));
+			key.push_back(word);
+		}
+	}
+
+	std::string SdePipelineRegistry::ShaderSource::name() const
+	{
+		if (!path.empty()) return path;
+		return "embedded@" + std::to_string(reinterpret_cast<uintptr_t>(code.code));
+	}
+
+	SdePipelineRegistry::SdePipelineRegistry(SdeDevice& device, SdeJobSystem& jobSystem) : m_Device(device), m_JobSystem(jobSystem)
+	{
+		m_Entries.resize(MAX_PIPELINES);
+	}
+
+	SdePipelineRegistry::~SdePipelineRegistry()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_QueueMutex);
+			m_Stop = true;
+		}
+		m_JobSystem.wait(m_Jobs);
+
+		auto device = m_Device.device();
+		std::vector<vk::Pipeline> pipelines;
+		uint32_t count = m_Count.load(std::memory_order_acquire);
+		for (uint32_t i = 0; i < count; i++) {
+			VkPipeline pipeline = m_Entries[i]->pipeline.load(std::memory_order_acquire);
+			if (pipeline != VK_NULL_HANDLE) {
+				pipelines.push_back(pipeline);
+			}
+		}
+
+		m_Device.deletionQueue().push([device, pipelines]() {
+			for (auto pipeline : pipelines) {
+				device.destroyPipeline(pipeline);
+			}
+		});
+
+		for (auto& [path, module] : m_ShaderModules) {
+			device.destroyShaderModule(module);
+		}
+	}
+
+	SdePipelineHandle SdePipelineRegistry::request(SdeShaderCode vertexCode, SdeShaderCode fragmentCode, const PipelineConfigInfo& configInfo)
+	{
+		return request(ShaderSource{ "", vertexCode }, ShaderSource{ "", fragmentCode }, configInfo);
+	}
+
+	SdePipelineHandle SdePipelineRegistry::request(const std::string& vertexPath, const std::string& fragmentPath, const PipelineConfigInfo& configInfo)
+	{
+		return request(ShaderSource{ vertexPath, {} }, ShaderSource{ fragmentPath, {} }, configInfo);
+	}
+
+	SdePipelineHandle SdePipelineRegistry::request(const ShaderSource& vertex, const ShaderSource& fragment, const PipelineConfigInfo& configInfo)
+	{
+		SDE_TRACE_FUNCTION();
+
+		auto key = makeKey(vertex, fragment, configInfo);
+
+		SdePipelineHandle handle;
+		{
+			std::lock_guard<std::mutex> lock(m_LookupMutex);
+
+			auto it = m_Lookup.find(key);
+			if (it != m_Lookup.end()) {
+				m_DeduplicatedCount.fetch_add(1, std::memory_order_relaxed);
+				return it->second;
+			}
+
+			handle = m_Count.load(std::memory_order_relaxed);
+			if (handle >= MAX_PIPELINES) {
+				throw std::runtime_error("Pipeline registry is full");
+			}
+
+			auto entry = std::make_unique<Entry>();
+			entry->vertex = vertex;
+			entry->fragment = fragment;
+			SdePipeline::copyPipelineConfigInfo(configInfo, entry->configInfo);
+
+			m_Entries[handle] = std::move(entry);
+			m_Lookup.emplace(std::move(key), handle);
+			m_Count.store(handle + 1, std::memory_order_release);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_ReadyMutex);
+			m_PendingCount++;
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_QueueMutex);
+			m_Queue.push_back(handle);
+		}
+		m_JobSystem.run([this]() { compileQueued(); }, &m_Jobs);
+
+		return handle;
+	}
+
+	bool SdePipelineRegistry::isReady(SdePipelineHandle handle) const
+	{
+		if (handle >= m_Count.load(std::memory_order_acquire)) return false;
+		return m_Entries[handle]->state.load(std::memory_order_acquire) == State::Ready;
+	}
+
+	void SdePipelineRegistry::wait(SdePipelineHandle handle)
+	{
+		SDE_TRACE_FUNCTION();
+
+		if (handle >= m_Count.load(std::memory_order_acquire)) {
+			throw std::runtime_error("Invalid pipeline handle");
+		}
+
+		auto& entry = *m_Entries[handle];
+		{
+			std::unique_lock<std::mutex> lock(m_ReadyMutex);
+			m_ReadyCondition.wait(lock, [&]() { return entry.state.load(std::memory_order_acquire) != State::Pending; });
+		}
+
+		if (entry.state.load(std::memory_order_acquire) == State::Failed) {
+			throw std::runtime_error("Failed to create graphics pipeline: " + entry.vertex.name() + ", " + entry.fragment.name());
+		}
+	}
+
+	void SdePipelineRegistry::waitIdle()
+	{
+		std::unique_lock<std::mutex> lock(m_ReadyMutex);
+		m_ReadyCondition.wait(lock, [&]() { return m_PendingCount == 0; });
+	}
+
+	bool SdePipelineRegistry::bind(vk::CommandBuffer commandBuffer, SdePipelineHandle handle)
+	{
+		if (!isReady(handle)) {
+			if (!isReady(m_Fallback)) return false;
+			handle = m_Fallback;
+		}
+
+		commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_Entries[handle]->pipeline.load(std::memory_order_acquire));
+		return true;
+	}
+
+	size_t SdePipelineRegistry::KeyHash::operator()(const std::vector<uint64_t>& key) const
+	{
+		// FNV-1a over the key words
+		uint64_t hash = 14695981039346656037ull;
+		for (uint64_t word : key) {
+			hash ^= word;
+			hash *= 1099511628211ull;
+		}
+		return static_cast<size_t>(hash);
+	}
+
+	std::vector<uint64_t> SdePipelineRegistry::makeKey(const ShaderSource& vertex, const ShaderSource& fragment, const PipelineConfigInfo& configInfo)
+	{
+		std::vector<uint64_t> key;
+		key.reserve(128);
+
+		// Shader modules, by path or by the address of the embedded code
+		for (const auto* source : { &vertex, &fragment }) {
+			appendString(key, source->path);
+			key.push_back(reinterpret_cast<uintptr_t>(source->code.code));
+			key.push_back(source->code.size);
+		}
+
+		// Vertex layout
+		key.push_back(configInfo.bindingDescriptions.size());
+		for (const auto& binding : configInfo.bindingDescriptions) {
+			key.push_back(binding.binding);
+			key.push_back(binding.stride);
+			key.push_back(static_cast<uint64_t>(binding.inputRate));
+		}
+		key.push_back(configInfo.attributeDescriptions.size());
+		for (const auto& attribute : configInfo.attributeDescriptions) {
+			key.push_back(attribute.location);
+			key.push_back(attribute.binding);
+			key.push_back(static_cast<uint64_t>(attribute.format));
+			key.push_back(attribute.offset);
+		}
+
+		// Fixed function state
+		key.push_back(static_cast<uint64_t>(configInfo.inputAssemblyInfo.topology));
+		key.push_back(configInfo.inputAssemblyInfo.primitiveRestartEnable);
+		key.push_back(configInfo.viewportInfo.viewportCount);
+		key.push_back(configInfo.viewportInfo.scissorCount);
+
+		const auto& rasterization = configInfo.rasterizationInfo;
+		key.push_back(rasterization.depthClampEnable);
+		key.push_back(rasterization.rasterizerDiscardEnable);
+		key.push_back(static_cast<uint64_t>(rasterization.polygonMode));
+		key.push_back(static_cast<uint64_t>(static_cast<VkCullModeFlags>(rasterization.cullMode)));
+		key.push_back(static_cast<uint64_t>(rasterization.frontFace));
+		key.push_back(rasterization.depthBiasEnable);
+		key.push_back(floatBits(rasterization.depthBiasConstantFactor));
+		key.push_back(floatBits(rasterization.depthBiasClamp));
+		key.push_back(floatBits(rasterization.depthBiasSlopeFactor));
+		key.push_back(floatBits(rasterization.lineWidth));
+
+		const auto& multisample = configInfo.multisampleInfo;
+		key.push_back(static_cast<uint64_t>(multisample.rasterizationSamples));
+		key.push_back(multisample.sampleShadingEnable);
+		key.push_back(floatBits(multisample.minSampleShading));
+		key.push_back(multisample.alphaToCoverageEnable);
+		key.push_back(multisample.alphaToOneEnable);
+
+		const auto& blend = configInfo.colorBlendAttachment;
+		key.push_back(blend.blendEnable);
+		key.push_back(static_cast<uint64_t>(blend.srcColorBlendFactor));
+		key.push_back(static_cast<uint64_t>(blend.dstColorBlendFactor));
+		key.push_back(static_cast<uint64_t>(blend.colorBlendOp));
+		key.push_back(static_cast<uint64_t>(blend.srcAlphaBlendFactor));
+		key.push_back(static_cast<uint64_t>(blend.dstAlphaBlendFactor));
+		key.push_back(static_cast<uint64_t>(blend.alphaBlendOp));
+		key.push_back(static_cast<uint64_t>(static_cast<VkColorComponentFlags>(blend.colorWriteMask)));
+
+		const auto& colorBlend = configInfo.colorBlendInfo;
+		key.push_back(colorBlend.logicOpEnable);
+		key.push_back(static_cast<uint64_t>(colorBlend.logicOp));
+		key.push_back(colorBlend.attachmentCount);
+		for (float constant : colorBlend.blendConstants) {
+			key.push_back(floatBits(constant));
+		}
+
+		const auto& depthStencil = configInfo.depthStencilInfo;
+		key.push_back(depthStencil.depthTestEnable);
+		key.push_back(depthStencil.depthWriteEnable);
+		key.push_back(static_cast<uint64_t>(depthStencil.depthCompareOp));
+		key.push_back(depthStencil.depthBoundsTestEnable);
+		key.push_back(floatBits(depthStencil.minDepthBounds));
+		key.push_back(floatBits(depthStencil.maxDepthBounds));
+		key.push_back(depthStencil.stencilTestEnable);
+		for (const auto* stencil : { &depthStencil.front, &depthStencil.back }) {
+			key.push_back(static_cast<uint64_t>(stencil->failOp));
+			key.push_back(static_cast<uint64_t>(stencil->passOp));
+			key.push_back(static_cast<uint64_t>(stencil->depthFailOp));
+			key.push_back(static_cast<uint64_t>(stencil->compareOp));
+			key.push_back(stencil->compareMask);
+			key.push_back(stencil->writeMask);
+			key.push_back(stencil->reference);
+		}
+
+		key.push_back(configInfo.dynamicStateEnables.size());
+		for (auto state : configInfo.dynamicStateEnables) {
+			key.push_back(static_cast<uint64_t>(state));
+		}
+
+		// Specialization, entries are sorted so equal sets give equal keys
+		const auto& specialization = configInfo.specialization;
+		key.push_back(specialization.getEntries().size());
+		for (const auto& entry : specialization.getEntries()) {
+			key.push_back(entry.constantID);
+			key.push_back(specialization.getBits(entry));
+		}
+
+		// Compatibility
+		key.push_back(handleBits(configInfo.pipelineLayout));
+		key.push_back(handleBits(configInfo.renderPass));
+		key.push_back(configInfo.subpass);
+
+		return key;
+	}
+
+	void SdePipelineRegistry::compileQueued()
+	{
+		std::vector<SdePipelineHandle> batch;
+		{
+			std::lock_guard<std::mutex> lock(m_QueueMutex);
+			if (m_Stop) return;
+
+			// Earlier jobs may have taken this job's handle already, then there is nothing left to do
+			while (!m_Queue.empty() && batch.size() < BATCH_SIZE) {
+				batch.push_back(m_Queue.front());
+				m_Queue.pop_front();
+			}
+		}
+
+		if (!batch.empty()) {
+			compileBatch(batch);
+		}
+	}
+
+	void SdePipelineRegistry::compileBatch(const std::vector<SdePipelineHandle>& batch)
+	{
+		SDE_TRACE_FUNCTION();
+
+		// Per pipeline state the create infos point into
+		struct PipelineState {
+			vk::PipelineShaderStageCreateInfo stages[2];
+			vk::SpecializationInfo specializationInfo;
+			vk::PipelineVertexInputStateCreateInfo vertexInputInfo;
+		};
+
+		std::vector<PipelineState> states(batch.size());
+		std::vector<vk::GraphicsPipelineCreateInfo> createInfos;
+		std::vector<SdePipelineHandle> handles;
+		createInfos.reserve(batch.size());
+
+		for (size_t i = 0; i < batch.size(); i++) {
+			auto& entry = *m_Entries[batch[i]];
+			auto& state = states[i];
+			const auto& configInfo = entry.configInfo;
+
+			try {
+				state.stages[0] = { vk::PipelineShaderStageCreateFlags(), vk::ShaderStageFlagBits::eVertex, getShaderModule(entry.vertex), "main" };
+				state.stages[1] = { vk::PipelineShaderStageCreateFlags(), vk::ShaderStageFlagBits::eFragment, getShaderModule(entry.fragment), "main" };
+			}
+			catch (const std::exception& err) {
+				std::cout << "Pipeline registry: " << err.what() << std::endl;
+				finish(batch[i], nullptr, true);
+				continue;
+			}
+
+			if (!configInfo.specialization.empty()) {
+				state.specializationInfo = configInfo.specialization.getInfo();
+				state.stages[0].pSpecializationInfo = &state.specializationInfo;
+				state.stages[1].pSpecializationInfo = &state.specializationInfo;
+			}
+
+			state.vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(configInfo.bindingDescriptions.size());
+			state.vertexInputInfo.pVertexBindingDescriptions = configInfo.bindingDescriptions.data();
+			state.vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(configInfo.attributeDescriptions.size());
+			state.vertexInputInfo.pVertexAttributeDescriptions = configInfo.attributeDescriptions.data();
+
+			vk::GraphicsPipelineCreateInfo pipelineInfo = {};
+			pipelineInfo.stageCount = 2;
+			pipelineInfo.pStages = state.stages;
+			pipelineInfo.pVertexInputState = &state.vertexInputInfo;
+			pipelineInfo.pInputAssemblyState = &configInfo.inputAssemblyInfo;
+			pipelineInfo.pViewportState = &configInfo.viewportInfo;
+			pipelineInfo.pRasterizationState = &configInfo.rasterizationInfo;
+			pipelineInfo.pMultisampleState = &configInfo.multisampleInfo;
+			pipelineInfo.pDepthStencilState = &configInfo.depthStencilInfo;
+			pipelineInfo.pColorBlendState = &configInfo.colorBlendInfo;
+			pipelineInfo.pDynamicState = &configInfo.dynamicStateInfo;
+			pipelineInfo.layout = configInfo.pipelineLayout;
+			pipelineInfo.renderPass = configInfo.renderPass;
+			pipelineInfo.subpass = configInfo.subpass;
+			pipelineInfo.basePipelineIndex = -1;
+
+			createInfos.push_back(pipelineInfo);
+			handles.push_back(batch[i]);
+		}
+
+		if (createInfos.empty()) return;
+
+		// One driver call for the whole batch, retry one by one to isolate a failing pipeline.
+		// The pointer overload does not throw, on failure some pipelines may still have been created.
+		std::vector<vk::Pipeline> pipelines(createInfos.size());
+		auto result = m_Device.device().createGraphicsPipelines(
+			m_Device.pipelineCache(),
+			static_cast<uint32_t>(createInfos.size()),
+			createInfos.data(),
+			nullptr,
+			pipelines.data()
+		);
+
+		if (result == vk::Result::eSuccess) {
+			for (size_t i = 0; i < handles.size(); i++) {
+				finish(handles[i], pipelines[i], false);
+			}
+			return;
+		}
+
+		for (auto pipeline : pipelines) {
+			if (pipeline) {
+				m_Device.device().destroyPipeline(pipeline);
+			}
+		}
+
+		for (size_t i = 0; i < handles.size(); i++) {
+			try {
+				auto single = m_Device.device().createGraphicsPipeline(m_Device.pipelineCache(), createInfos[i]);
+				finish(handles[i], single.value, false);
+			}
+			catch (const vk::SystemError& err) {
+				std::cout << "Pipeline registry: " << err.what() << std::endl;
+				finish(handles[i], nullptr, true);
+			}
+		}
+	}
+
+	vk::ShaderModule SdePipelineRegistry::getShaderModule(const ShaderSource& source)
+	{
+		auto name = source.name();
+		{
+			std::lock_guard<std::mutex> lock(m_ShaderModuleMutex);
+			auto it = m_ShaderModules.find(name);
+			if (it != m_ShaderModules.end()) return it->second;
+		}
+
+		vk::ShaderModuleCreateInfo createInfo = {};
+		std::vector<uint32_t> fileCode;
+		if (source.path.empty()) {
+			createInfo.codeSize = source.code.size;
+			createInfo.pCode = source.code.code;
+		}
+		else {
+			fileCode = SdePipeline::readFile(source.path);
+			createInfo.codeSize = fileCode.size() * sizeof(uint32_t);
+			createInfo.pCode = fileCode.data();
+		}
+		auto module = m_Device.device().createShaderModule(createInfo);
+
+		// Another worker may have loaded it meanwhile, keep the first one
+		std::lock_guard<std::mutex> lock(m_ShaderModuleMutex);
+		auto [it, inserted] = m_ShaderModules.emplace(name, module);
+		if (!inserted) {
+			m_Device.device().destroyShaderModule(module);
+		}
+		return it->second;
+	}
+
+	void SdePipelineRegistry::finish(SdePipelineHandle handle, vk::Pipeline pipeline, bool failed)
+	{
+		auto& entry = *m_Entries[handle];
+		entry.pipeline.store(static_cast<VkPipeline>(pipeline), std::memory_order_release);
+
+		{
+			std::lock_guard<std::mutex> lock(m_ReadyMutex);
+			entry.state.store(failed ? State::Failed : State::Ready, std::memory_order_release);
+			m_PendingCount--;
+		}
+		m_ReadyCondition.notify_all();
+	}
+
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "sde_device.h"
+#include "sde_pipeline.h"
+#include "sde_job_system.h"
+
+#include <vulkan/vulkan.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sde {
+
+	using SdePipelineHandle = uint32_t;
+
+	// Deduplicates graphics pipelines by their full state and compiles new ones as jobs.
+	// Handles are valid immediately, bind() falls back to the fallback pipeline until they are ready.
+	class SdePipelineRegistry {
+	public:
+		static constexpr SdePipelineHandle INVALID_PIPELINE = UINT32_MAX;
+		static constexpr uint32_t MAX_PIPELINES = 4096;
+		// Pipelines handed to a single createGraphicsPipelines call
+		static constexpr uint32_t BATCH_SIZE = 8;
+
+		SdePipelineRegistry(SdeDevice& device, SdeJobSystem& jobSystem);
+		// Drops the requests no job picked up yet and waits for the compiles in progress
+		~SdePipelineRegistry();
+
+		SdePipelineRegistry(const SdePipelineRegistry&) = delete;
+		SdePipelineRegistry& operator=(const SdePipelineRegistry&) = delete;
+
+		// Returns the existing handle when the same state was requested before.
+		// Embedded code is identified by its address, it must outlive the registry.
+		SdePipelineHandle request(SdeShaderCode vertexCode, SdeShaderCode fragmentCode, const PipelineConfigInfo& configInfo);
+		SdePipelineHandle request(const std::string& vertexPath, const std::string& fragmentPath, const PipelineConfigInfo& configInfo);
+
+		bool isReady(SdePipelineHandle handle) const;
+		// Blocks until compiled, throws if compilation failed
+		void wait(SdePipelineHandle handle);
+		void waitIdle();
+
+		// Bound instead of pipelines that are not ready yet
+		void setFallback(SdePipelineHandle handle) { m_Fallback = handle; }
+		// Returns false when neither the pipeline nor the fallback is ready, nothing is bound then
+		bool bind(vk::CommandBuffer commandBuffer, SdePipelineHandle handle);
+
+		uint32_t getPipelineCount() const { return m_Count.load(std::memory_order_acquire); }
+		uint32_t getDeduplicatedCount() const { return m_DeduplicatedCount.load(std::memory_order_relaxed); }
+
+	private:
+		enum class State { Pending, Ready, Failed };
+
+		// Either a .spv path or embedded code
+		struct ShaderSource {
+			std::string path;
+			SdeShaderCode code;
+
+			std::string name() const;
+		};
+
+		struct Entry {
+			ShaderSource vertex;
+			ShaderSource fragment;
+			PipelineConfigInfo configInfo;
+
+			std::atomic<VkPipeline> pipeline{ VK_NULL_HANDLE };
+			std::atomic<State> state{ State::Pending };
+		};
+
+		struct KeyHash {
+			size_t operator()(const std::vector<uint64_t>& key) const;
+		};
+
+		SdePipelineHandle request(const ShaderSource& vertex, const ShaderSource& fragment, const PipelineConfigInfo& configInfo);
+		static std::vector<uint64_t> makeKey(const ShaderSource& vertex, const ShaderSource& fragment, const PipelineConfigInfo& configInfo);
+
+		void compileQueued();
+		void compileBatch(const std::vector<SdePipelineHandle>& batch);
+		vk::ShaderModule getShaderModule(const ShaderSource& source);
+		void finish(SdePipelineHandle handle, vk::Pipeline pipeline, bool failed);
+
+	private:
+		SdeDevice& m_Device;
+		SdeJobSystem& m_JobSystem;
+
+		// Slots are allocated up front so readers never race with growth
+		std::vector<std::unique_ptr<Entry>> m_Entries;
+		std::atomic<uint32_t> m_Count{ 0 };
+		std::atomic<uint32_t> m_DeduplicatedCount{ 0 };
+		std::unordered_map<std::vector<uint64_t>, SdePipelineHandle, KeyHash> m_Lookup;
+		std::mutex m_LookupMutex;
+
+		SdePipelineHandle m_Fallback = INVALID_PIPELINE;
+
+		std::unordered_map<std::string, vk::ShaderModule> m_ShaderModules;
+		std::mutex m_ShaderModuleMutex;
+
+		// Every request queues one job, each job compiles up to BATCH_SIZE of the queued handles
+		std::deque<SdePipelineHandle> m_Queue;
+		std::mutex m_QueueMutex;
+		bool m_Stop = false;
+		SdeJobCounter m_Jobs;
+
+		std::mutex m_ReadyMutex;
+		std::condition_variable m_ReadyCondition;
+		uint32_t m_PendingCount = 0;
+	};
+
+}
@@ -1,21 +1,50 @@
 #include "sde_renderer.h"
+#include "sde_trace.h"
+#include "sde_upload_manager.h"
+#include "sde_timeline.h"
+#include "sde_deletion_queue.h"
 
 namespace sde {
 
-	SdeRenderer::SdeRenderer(SdeWindow& window, SdeDevice& device) : m_SdeWindow(window), m_SdeDevice(device)
+	SdeRenderer::SdeRenderer(SdeWindow& window, SdeDevice& device, const SdeRendererConfig& config) : m_SdeWindow(&window), m_SdeDevice(device), m_Config(config)
 	{
 		recreateSwapChain();
-		createCommandBuffers();
+		createFrameResources();
+	}
+
+	SdeRenderer::SdeRenderer(SdeDevice& device, vk::Extent2D extent, const SdeRendererConfig& config) : m_SdeDevice(device), m_Config(config), m_HeadlessExtent(extent)
+	{
+		if (!device.isHeadless()) {
+			throw std::runtime_error("Headless renderer requires a headless device");
+		}
+
+		recreateSwapChain();
+		createFrameResources();
 	}
 
 	SdeRenderer::~SdeRenderer()
 	{
-		freeCommandBuffers();
+		// Frame contexts run their deferred destroys on destruction
+		m_SdeDevice.device().waitIdle();
+	}
+
+	void SdeRenderer::waitForFrame()
+	{
+		SDE_TRACE_FUNCTION();
+
+		// The single wait of the frame loop, for the frame that used this slot last.
+		// Returns right away when the caller already waited before sampling input.
+		auto& timeline = m_SdeDevice.timeline();
+		timeline.wait(m_Config.lowLatency ? timeline.getLastSubmittedValue() : m_FrameValues[m_CurrentFrameIndex]);
 	}
 
 	vk::CommandBuffer SdeRenderer::beginFrame()
 	{
-		auto acquireData = m_SdeSwapChain->acquireNextImage();
+		SDE_TRACE_FUNCTION();
+
+		waitForFrame();
+
+		auto acquireData = m_SdeSwapChain->acquireNextImage(m_CurrentFrameIndex);
 
 		if (acquireData.result == vk::Result::eErrorOutOfDateKHR) {
 			recreateSwapChain();
@@ -29,12 +58,33 @@ namespace sde {
 		// Update index
 		m_CurrentImageIndex = acquireData.value;
 
+		// Release staging memory of uploads that finished meanwhile, and whatever the retired frames still used
+		m_SdeDevice.uploadManager().collect();
+		m_SdeDevice.deletionQueue().collect();
+
+		// The frame retired above, recycle everything it used
+		m_FrameContexts[m_CurrentFrameIndex]->reset();
+
+		// Destroyed from here on, resources may be part of this frame
+		m_SdeDevice.deletionQueue().beginFrame();
+
 		auto commandBuffer = getCurrentCommandBuffer();
 		try {
-			commandBuffer.begin(vk::CommandBufferBeginInfo({ vk::CommandBufferUsageFlagBits::eSimultaneousUse }));
+			try {
+				commandBuffer.begin(vk::CommandBufferBeginInfo({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit }));
+			}
+			catch (vk::SystemError err) {
+				throw new std::runtime_error("Failed to record(begin) command buffer");
+			}
+
+			m_GpuProfiler->beginFrame(commandBuffer, m_CurrentFrameIndex);
+			m_UniformRing->beginFrame(m_CurrentFrameIndex);
+			m_ParallelRecorder->beginFrame(m_CurrentFrameIndex);
+			m_FrameScope = m_GpuProfiler->beginScope(commandBuffer, "Frame");
 		}
-		catch (vk::SystemError err) {
-			throw new std::runtime_error("Failed to record(begin) command buffer");
+		catch (...) {
+			m_SdeDevice.deletionQueue().abortFrame();
+			throw;
 		}
 
 		return commandBuffer;
@@ -42,29 +92,129 @@ namespace sde {
 
 	void SdeRenderer::endFrame()
 	{
+		SDE_TRACE_FUNCTION();
+
 		// End command buffer
 		auto commandBuffer = getCurrentCommandBuffer();
+		vk::ResultValue<uint64_t> submitData(vk::Result::eSuccess, 0);
+
+		// Whatever throws, the deletion queue must not keep holding pushes for this frame
 		try {
-			commandBuffer.end();
+			m_GpuProfiler->endScope(commandBuffer, m_FrameScope);
+
+			try {
+				commandBuffer.end();
+			}
+			catch (vk::SystemError err) {
+				throw new std::runtime_error("Failed to record(end) command buffer");
+			}
+
+			// Uploads recorded during the frame go first on the same queue, the batch barrier orders them before the draws
+			m_SdeDevice.uploadManager().flush();
+			m_UniformRing->flush();
+
+			// Submit command
+			submitData = m_SdeSwapChain->submitCommandBuffers(&commandBuffer, m_CurrentImageIndex, m_CurrentFrameIndex);
 		}
-		catch (vk::SystemError err) {
-			throw new std::runtime_error("Failed to record(end) command buffer");
+		catch (...) {
+			m_SdeDevice.deletionQueue().abortFrame();
+			throw;
 		}
 
-		// Submit command
-		auto result = m_SdeSwapChain->submitCommandBuffers(&commandBuffer, m_CurrentImageIndex);
-		if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR || m_SdeWindow.hasResized()) {
-			m_SdeWindow.resetResized();
+		m_FrameValues[m_CurrentFrameIndex] = submitData.value;
+		m_SdeDevice.deletionQueue().endFrame(submitData.value);
+
+		auto result = submitData.result;
+		bool resized = isHeadless() ? m_HeadlessResized : m_SdeWindow->hasResized();
+		if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR || resized) {
+			if (isHeadless()) {
+				m_HeadlessResized = false;
+			}
+			else {
+				m_SdeWindow->resetResized();
+			}
 			recreateSwapChain();
 		}
 		else if (result != vk::Result::eSuccess) {
 			throw new std::runtime_error("Failed to present image");
 		}
 
-		m_CurrentFrameIndex = (m_CurrentFrameIndex + 1) % SdeSwapChain::MAX_FRAMES_IN_FLIGHT;
+		m_CurrentFrameIndex = (m_CurrentFrameIndex + 1) % getFramesInFlight();
+	}
+
+	void SdeRenderer::setUniformRingSize(vk::DeviceSize frameSize)
+	{
+		m_UniformRing = std::make_unique<SdeUniformRing>(m_SdeDevice, getFramesInFlight(), frameSize);
+	}
+
+	void SdeRenderer::setJobSystem(SdeJobSystem* jobSystem)
+	{
+		m_JobSystem = jobSystem;
+		m_ParallelRecorder = std::make_unique<SdeParallelRecorder>(m_SdeDevice, getFramesInFlight(), jobSystem);
+	}
+
+	void SdeRenderer::setConfig(const SdeRendererConfig& config)
+	{
+		SDE_TRACE_FUNCTION();
+
+		// Checked before the current swapchain is retired
+		if (config.swapChain.framesInFlight < 1 || config.swapChain.framesInFlight > SdeSwapChain::MAX_FRAMES_IN_FLIGHT) {
+			throw std::runtime_error("Frames in flight must be between 1 and MAX_FRAMES_IN_FLIGHT");
+		}
+
+		bool framesChanged = config.swapChain.framesInFlight != m_Config.swapChain.framesInFlight;
+		m_Config = config;
+
+		// Rare enough to drain the GPU, the per frame resources may be replaced below
+		m_SdeDevice.device().waitIdle();
+		recreateSwapChain();
+
+		if (framesChanged) {
+			createFrameResources();
+		}
 	}
 
-	void SdeRenderer::beginSwapChainRenderPass(vk::CommandBuffer commandBuffer)
+	void SdeRenderer::recordParallel(vk::CommandBuffer commandBuffer, uint32_t itemCount, const SdeRecordFunction& recordRange)
+	{
+		SDE_TRACE_FUNCTION();
+
+		vk::CommandBufferInheritanceInfo inheritance = {};
+		inheritance.renderPass = m_SdeSwapChain->getRenderPass();
+		inheritance.subpass = 0;
+		inheritance.framebuffer = m_SdeSwapChain->getFramebuffer(m_CurrentImageIndex);
+
+		// Dynamic state is not inherited from the primary
+		auto secondaries = m_ParallelRecorder->record(inheritance, itemCount, [&](vk::CommandBuffer secondary, uint32_t begin, uint32_t end) {
+			setViewportAndScissor(secondary);
+			recordRange(secondary, begin, end);
+		});
+
+		if (!secondaries.empty()) {
+			commandBuffer.executeCommands(secondaries);
+		}
+	}
+
+	vk::PushConstantRange SdeRenderer::objectPushConstantRange()
+	{
+		vk::PushConstantRange range = {};
+		range.stageFlags = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment;
+		range.offset = 0;
+		range.size = sizeof(SdeObjectPushConstants);
+
+		return range;
+	}
+
+	void SdeRenderer::pushObjectConstants(vk::CommandBuffer commandBuffer, vk::PipelineLayout pipelineLayout, const glm::mat4& model, uint32_t objectId)
+	{
+		SdeObjectPushConstants constants = {};
+		constants.model = model;
+		constants.objectId = objectId;
+
+		auto range = objectPushConstantRange();
+		commandBuffer.pushConstants(pipelineLayout, range.stageFlags, range.offset, range.size, &constants);
+	}
+
+	void SdeRenderer::beginSwapChainRenderPass(vk::CommandBuffer commandBuffer, vk::SubpassContents contents)
 	{
 		vk::RenderPassBeginInfo renderPassInfo = {};
 		renderPassInfo.renderPass = m_SdeSwapChain->getRenderPass();
@@ -76,8 +226,16 @@ namespace sde {
 		renderPassInfo.clearValueCount = 1;
 		renderPassInfo.pClearValues = &clearColor;
 
-		commandBuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
+		commandBuffer.beginRenderPass(renderPassInfo, contents);
 
+		// Secondaries set their own, see recordParallel
+		if (contents == vk::SubpassContents::eInline) {
+			setViewportAndScissor(commandBuffer);
+		}
+	}
+
+	void SdeRenderer::setViewportAndScissor(vk::CommandBuffer commandBuffer)
+	{
 		vk::Viewport viewport = {};
 		viewport.x = 0.0f;
 		viewport.y = 0.0f;
@@ -97,50 +255,64 @@ namespace sde {
 		buffer.endRenderPass();
 	}
 
-	void SdeRenderer::recreateSwapChain()
+	void SdeRenderer::resize(vk::Extent2D extent)
 	{
-		auto extent = m_SdeWindow.getExtent();
-		while (extent.width == 0 || extent.height == 0) {
-			extent = m_SdeWindow.getExtent();
-			glfwWaitEvents();
+		if (!isHeadless()) return;
+
+		if (extent.width == 0 || extent.height == 0) {
+			throw std::runtime_error("Headless extent must not be empty");
 		}
 
-		m_SdeDevice.device().waitIdle();
+		m_HeadlessExtent = extent;
+		m_HeadlessResized = true;
+	}
+
+	void SdeRenderer::recreateSwapChain()
+	{
+		SDE_TRACE_FUNCTION();
+
+		vk::Extent2D extent = m_HeadlessExtent;
+		if (!isHeadless()) {
+			extent = m_SdeWindow->getExtent();
+			while (extent.width == 0 || extent.height == 0) {
+				extent = m_SdeWindow->getExtent();
+				glfwWaitEvents();
+			}
+		}
 
 		if (m_SdeSwapChain == nullptr) {
-			m_SdeSwapChain = std::make_unique<SdeSwapChain>(m_SdeDevice, extent);
+			m_SdeSwapChain = std::make_unique<SdeSwapChain>(m_SdeDevice, extent, m_Config.swapChain);
 		}
 		else {
 			std::shared_ptr<SdeSwapChain> oldSwapChain = std::move(m_SdeSwapChain);
-			m_SdeSwapChain = std::make_unique<SdeSwapChain>(m_SdeDevice, extent, oldSwapChain);
+			m_SdeSwapChain = std::make_unique<SdeSwapChain>(m_SdeDevice, extent, m_Config.swapChain, oldSwapChain);
 
 			if (!oldSwapChain->compareSwapFormats(*m_SdeSwapChain.get())) {
 				throw std::runtime_error("Swap chain image(or depth) format has changed!");
 			}
+
+			// No device idle. The new swapchain holds the old one until its presents are done, then
+			// the old one's destructor defers everything until the frames that used it retired
 		}
 	}
 
-	void SdeRenderer::createCommandBuffers()
+	void SdeRenderer::createFrameResources()
 	{
-		m_CommandBuffers.resize(SdeSwapChain::MAX_FRAMES_IN_FLIGHT);
-
-		vk::CommandBufferAllocateInfo allocInfo = {};
-		allocInfo.commandPool = m_SdeDevice.commandPool();
-		allocInfo.level = vk::CommandBufferLevel::ePrimary;
-		allocInfo.commandBufferCount = (uint32_t)m_CommandBuffers.size();
+		// Runs after a waitIdle, nothing of the previous resources is in flight
+		uint32_t framesInFlight = getFramesInFlight();
+		vk::DeviceSize ringFrameSize = m_UniformRing ? m_UniformRing->getFrameSize() : SdeUniformRing::DEFAULT_FRAME_SIZE;
 
-		try {
-			m_CommandBuffers = m_SdeDevice.device().allocateCommandBuffers(allocInfo);
-		}
-		catch (vk::SystemError err) {
-			throw std::runtime_error("Failed to allocate command buffers");
+		m_FrameContexts.clear();
+		for (uint32_t i = 0; i < framesInFlight; i++) {
+			m_FrameContexts.push_back(std::make_unique<SdeFrameContext>(m_SdeDevice));
 		}
-	}
 
-	void SdeRenderer::freeCommandBuffers()
-	{
-		m_SdeDevice.device().freeCommandBuffers(m_SdeDevice.commandPool(), m_CommandBuffers);
-		m_CommandBuffers.clear();
+		m_GpuProfiler = std::make_unique<SdeGpuProfiler>(m_SdeDevice, framesInFlight);
+		m_UniformRing = std::make_unique<SdeUniformRing>(m_SdeDevice, framesInFlight, ringFrameSize);
+		m_ParallelRecorder = std::make_unique<SdeParallelRecorder>(m_SdeDevice, framesInFlight, m_JobSystem);
+
+		m_CurrentFrameIndex = 0;
+		m_FrameValues = {};
 	}
 
 }
\ No newline at end of file
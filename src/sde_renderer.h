@@ -3,52 +3,131 @@
 #include "sde_device.h"
 #include "sde_window.h"
 #include "sde_swap_chain.h"
+#include "sde_gpu_profiler.h"
+#include "sde_uniform_ring.h"
+#include "sde_parallel_recorder.h"
+#include "sde_frame_context.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
 #include <vulkan/vulkan.hpp>
+#include <array>
 
 namespace sde {
 
+	// Matches ObjectPushConstants in shaders/shader.vert
+	struct SdeObjectPushConstants {
+		glm::mat4 model{ 1.f };
+		uint32_t objectId = 0;
+	};
+
+	struct SdeRendererConfig {
+		SdeSwapChainConfig swapChain;
+		// waitForFrame waits until the GPU drained every submitted frame instead of only the frame slot
+		// about to be reused. Input sampled afterwards reaches the screen sooner, at the cost of throughput.
+		bool lowLatency = false;
+	};
+
 	class SdeRenderer {
 	public:
-		SdeRenderer(SdeWindow& window, SdeDevice& device);
+		SdeRenderer(SdeWindow& window, SdeDevice& device, const SdeRendererConfig& config = {});
+		// Headless renderer, draws into offscreen images of the given extent
+		SdeRenderer(SdeDevice& device, vk::Extent2D extent, const SdeRendererConfig& config = {});
 		~SdeRenderer();
 
 		SdeRenderer(const SdeRenderer&) = delete;
 		SdeRenderer& operator =(const SdeRenderer&) = delete;
 
 	public:
+		// Call right before sampling input, beginFrame waits here itself otherwise
+		void waitForFrame();
 		vk::CommandBuffer beginFrame();
 		void endFrame();
-		void beginSwapChainRenderPass(vk::CommandBuffer buffer);
+		// With eSecondaryCommandBuffers the pass may only be filled through recordParallel
+		void beginSwapChainRenderPass(vk::CommandBuffer buffer, vk::SubpassContents contents = vk::SubpassContents::eInline);
 		void endSwapChainRenderPass(vk::CommandBuffer buffer);
 
+		// Records itemCount draws into secondaries as jobs and executes them in order.
+		// Each secondary starts with viewport and scissor set, everything else must be bound per secondary.
+		void recordParallel(vk::CommandBuffer commandBuffer, uint32_t itemCount, const SdeRecordFunction& recordRange);
+		// Records on jobSystem from now on, null records on the calling thread. No frame may be in flight.
+		void setJobSystem(SdeJobSystem* jobSystem);
+
+		const SdeRendererConfig& getConfig() const { return m_Config; }
+		uint32_t getFramesInFlight() const { return m_Config.swapChain.framesInFlight; }
+		// Applies between frames by recreating the swapchain. Changing framesInFlight also replaces the
+		// per frame resources, the uniform ring included, so its descriptor sets must be rewritten.
+		void setConfig(const SdeRendererConfig& config);
+
+		// Range to add to pipeline layouts that use pushObjectConstants
+		static vk::PushConstantRange objectPushConstantRange();
+		// Per draw model matrix and object id, no buffer writes or descriptor updates
+		void pushObjectConstants(vk::CommandBuffer commandBuffer, vk::PipelineLayout pipelineLayout, const glm::mat4& model, uint32_t objectId = 0);
+
+		// The only frame counter, the swapchain and every per frame resource are indexed by it.
+		// Always below getFramesInFlight(), so arrays of MAX_FRAMES_IN_FLIGHT fit any config.
 		int getFrameIndex() const {
 			return m_CurrentFrameIndex;
 		}
 
+		// Timeline value of the last submit of each frame slot, the slot is free once it completed
+		uint64_t getFrameValue(int frameIndex) const { return m_FrameValues[frameIndex]; }
+
 		vk::RenderPass getSwapChainRenderPass() { return m_SdeSwapChain->getRenderPass(); }
 
 		vk::CommandBuffer getCurrentCommandBuffer() const {
-			return m_CommandBuffers[m_CurrentFrameIndex];
+			return m_FrameContexts[m_CurrentFrameIndex]->getCommandBuffer();
 		}
 
+		// Transient resources of the frame being recorded, recycled when it comes around again
+		SdeFrameContext& frameContext() { return *m_FrameContexts[m_CurrentFrameIndex]; }
+
 		float getAspectRatio() const {
 			return m_SdeSwapChain->getAspectRatio();
 		}
 
+		bool isHeadless() const { return m_SdeWindow == nullptr; }
+
+		// GPU timings of the frames that already retired, a "Frame" scope is always recorded
+		SdeGpuProfiler& gpuProfiler() { return *m_GpuProfiler; }
+
+		// Per draw uniform blocks, reset every frame once it retired
+		SdeUniformRing& uniformRing() { return *m_UniformRing; }
+		// Replaces the ring, no frame may be in flight and descriptor sets of the old ring must be rewritten
+		void setUniformRingSize(vk::DeviceSize frameSize);
+
+		// Headless only: the window resize callback equivalent
+		void resize(vk::Extent2D extent);
+
 	private:
 		void recreateSwapChain();
-		void createCommandBuffers();
-		void freeCommandBuffers();
+		// Frame contexts, profiler, uniform ring and parallel recorder, sized by framesInFlight
+		void createFrameResources();
+		void setViewportAndScissor(vk::CommandBuffer commandBuffer);
 
 	private:
-		SdeWindow& m_SdeWindow;
+		SdeWindow* m_SdeWindow = nullptr;
 		SdeDevice& m_SdeDevice;
+		SdeRendererConfig m_Config;
+		SdeJobSystem* m_JobSystem = nullptr;
 		std::shared_ptr<SdeSwapChain> m_SdeSwapChain;
 
-		std::vector<vk::CommandBuffer> m_CommandBuffers;
+		std::vector<std::unique_ptr<SdeFrameContext>> m_FrameContexts;
+
+		std::unique_ptr<SdeGpuProfiler> m_GpuProfiler;
+		uint32_t m_FrameScope = SdeGpuProfiler::INVALID_SCOPE;
+
+		std::unique_ptr<SdeUniformRing> m_UniformRing;
+		std::unique_ptr<SdeParallelRecorder> m_ParallelRecorder;
 
 		uint32_t m_CurrentImageIndex;
 		int m_CurrentFrameIndex = 0;
+		std::array<uint64_t, SdeSwapChain::MAX_FRAMES_IN_FLIGHT> m_FrameValues = {};
+
+		vk::Extent2D m_HeadlessExtent;
+		bool m_HeadlessResized = false;
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,76 @@
+#include "sde_scene_descriptors.h"
+
+namespace sde {
+
+	SdeSceneDescriptors::SdeSceneDescriptors(SdeDevice& device, SdeRenderer& renderer, vk::DescriptorSetLayout drawListSetLayout) : m_Device(device)
+	{
+		m_Pool = SdeDescriptorPool::Builder(m_Device)
+			.setMaxSets(SdeSwapChain::MAX_FRAMES_IN_FLIGHT + 1)
+			.addPoolSize(vk::DescriptorType::eUniformBuffer, SdeSwapChain::MAX_FRAMES_IN_FLIGHT)
+			.addPoolSize(vk::DescriptorType::eUniformBufferDynamic, 1)
+			.build();
+
+		m_UboBuffers.resize(SdeSwapChain::MAX_FRAMES_IN_FLIGHT);
+		m_GlobalSets.resize(SdeSwapChain::MAX_FRAMES_IN_FLIGHT);
+
+		// 1. Allocate UBO buffers
+		for (size_t i = 0; i < m_UboBuffers.size(); i++) {
+			m_UboBuffers[i] = std::make_unique<SdeBuffer>(
+				m_Device,
+				sizeof(GlobalUbo),
+				vk::BufferUsageFlagBits::eUniformBuffer,
+				vma::AllocationCreateFlagBits::eMapped | vma::AllocationCreateFlagBits::eHostAccessSequentialWrite
+			);
+		}
+
+		// 2. Create set layout
+		m_GlobalSetLayout = SdeDescriptorSetLayout::Builder(m_Device)
+			.addBinding(0, vk::DescriptorType::eUniformBuffer, vk::ShaderStageFlagBits::eAll)
+			.build();
+
+		// 3. Create descriptor sets
+		for (size_t i = 0; i < m_GlobalSets.size(); i++) {
+			vk::DescriptorBufferInfo bufferInfo = {};
+			bufferInfo.buffer = m_UboBuffers[i]->getBuffer();
+			bufferInfo.offset = 0;
+			bufferInfo.range = sizeof(GlobalUbo);
+
+			m_GlobalSets[i] = SdeDescriptorWriter(*m_GlobalSetLayout, *m_Pool)
+				.writeBuffer(0, &bufferInfo)
+				.build();
+		}
+
+		// 3.1 Per object set, one for all frames since the ring offsets are absolute
+		m_ObjectSetLayout = SdeDescriptorSetLayout::Builder(m_Device)
+			.addBinding(0, vk::DescriptorType::eUniformBufferDynamic, vk::ShaderStageFlagBits::eVertex)
+			.build();
+
+		auto objectBufferInfo = renderer.uniformRing().getDescriptorInfo(sizeof(ObjectUniforms));
+		m_ObjectSet = SdeDescriptorWriter(*m_ObjectSetLayout, *m_Pool)
+			.writeBuffer(0, &objectBufferInfo)
+			.build();
+
+		// 4. Create pipeline layout
+		std::vector<vk::DescriptorSetLayout> descriptorSetLayouts = {
+			m_GlobalSetLayout->getDescriptorSetLayout(),
+			drawListSetLayout,
+			m_ObjectSetLayout->getDescriptorSetLayout()
+		};
+		vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+		pipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+		pipelineLayoutCreateInfo.pSetLayouts = descriptorSetLayouts.data();
+
+		// 4.1 Add push constants
+		auto pushConstantRange = SdeRenderer::objectPushConstantRange();
+		pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+		pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+		m_PipelineLayout = m_Device.device().createPipelineLayout(pipelineLayoutCreateInfo);
+	}
+
+	SdeSceneDescriptors::~SdeSceneDescriptors()
+	{
+		m_Device.device().destroyPipelineLayout(m_PipelineLayout);
+	}
+
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "sde_device.h"
+#include "sde_renderer.h"
+#include "sde_buffer.h"
+#include "sde_descriptors.h"
+
+#include "glm/glm.hpp"
+
+#include <vulkan/vulkan.hpp>
+#include <memory>
+#include <vector>
+
+namespace sde {
+
+	// Per frame data only, per object transforms go through SdeRenderer::pushObjectConstants
+	struct GlobalUbo {
+		glm::mat4 viewProjection{ 1.f };
+	};
+
+	// Per draw data too big for push constants, allocated from SdeRenderer::uniformRing
+	struct ObjectUniforms {
+		glm::vec4 tint{ 1.f };
+	};
+
+	// Descriptors and pipeline layout shared by the app and the benchmark.
+	// Set 0: global UBO per frame in flight, set 1: per object data of the indirect path,
+	// set 2: per draw uniforms from the renderer's uniform ring.
+	class SdeSceneDescriptors {
+	public:
+		// Size the uniform ring before, the per draw set points at its buffer
+		SdeSceneDescriptors(SdeDevice& device, SdeRenderer& renderer, vk::DescriptorSetLayout drawListSetLayout);
+		~SdeSceneDescriptors();
+
+		SdeSceneDescriptors(const SdeSceneDescriptors&) = delete;
+		SdeSceneDescriptors& operator=(const SdeSceneDescriptors&) = delete;
+
+		SdeBuffer& getUboBuffer(int frameIndex) { return *m_UboBuffers[frameIndex]; }
+		vk::PipelineLayout getPipelineLayout() const { return m_PipelineLayout; }
+		vk::DescriptorSet getGlobalSet(int frameIndex) const { return m_GlobalSets[frameIndex]; }
+		vk::DescriptorSet getObjectSet() const { return m_ObjectSet; }
+
+	private:
+		SdeDevice& m_Device;
+
+		std::unique_ptr<SdeDescriptorPool> m_Pool;
+		std::unique_ptr<SdeDescriptorSetLayout> m_GlobalSetLayout;
+		std::vector<std::unique_ptr<SdeBuffer>> m_UboBuffers;
+		std::vector<vk::DescriptorSet> m_GlobalSets;
+
+		std::unique_ptr<SdeDescriptorSetLayout> m_ObjectSetLayout;
+		vk::DescriptorSet m_ObjectSet;
+
+		vk::PipelineLayout m_PipelineLayout;
+	};
+
+}
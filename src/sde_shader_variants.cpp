@@ -0,0 +1,81 @@
+#include "sde_shader_variants.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace sde {
+
+	SdeShaderVariantSet& SdeShaderVariantSet::addOption(const std::string& name, uint32_t constantId, const std::vector<uint32_t>& values)
+	{
+		if (values.empty()) {
+			throw std::runtime_error("Shader variant option has no values: " + name);
+		}
+		for (const auto& option : m_Options) {
+			if (option.constantId == constantId) {
+				throw std::runtime_error("Shader variant options share a constant id: " + option.name + ", " + name);
+			}
+		}
+		if (static_cast<uint64_t>(m_VariantCount) * values.size() > MAX_VARIANTS) {
+			throw std::runtime_error("Too many shader variants, adding option: " + name);
+		}
+
+		m_Options.push_back({ name, constantId, values });
+		m_VariantCount *= static_cast<uint32_t>(values.size());
+		return *this;
+	}
+
+	uint32_t SdeShaderVariantSet::getVariantIndex(const std::vector<uint32_t>& values) const
+	{
+		if (values.size() != m_Options.size()) {
+			throw std::runtime_error("Shader variant needs one value per option");
+		}
+
+		uint32_t index = 0;
+		uint32_t stride = 1;
+		for (size_t i = 0; i < m_Options.size(); i++) {
+			const auto& optionValues = m_Options[i].values;
+			auto it = std::find(optionValues.begin(), optionValues.end(), values[i]);
+			if (it == optionValues.end()) {
+				throw std::runtime_error("Invalid value for shader variant option: " + m_Options[i].name);
+			}
+
+			index += static_cast<uint32_t>(it - optionValues.begin()) * stride;
+			stride *= static_cast<uint32_t>(optionValues.size());
+		}
+		return index;
+	}
+
+	SdeSpecializationConstants SdeShaderVariantSet::getConstants(uint32_t variantIndex) const
+	{
+		if (variantIndex >= m_VariantCount) {
+			throw std::runtime_error("Invalid shader variant index");
+		}
+
+		SdeSpecializationConstants constants;
+		for (const auto& option : m_Options) {
+			uint32_t count = static_cast<uint32_t>(option.values.size());
+			constants.setUint(option.constantId, option.values[variantIndex % count]);
+			variantIndex /= count;
+		}
+		return constants;
+	}
+
+	std::vector<SdePipelineHandle> SdeShaderVariantSet::request(
+		SdePipelineRegistry& registry,
+		SdeShaderCode vertexCode,
+		SdeShaderCode fragmentCode,
+		const PipelineConfigInfo& configInfo) const
+	{
+		PipelineConfigInfo variantConfig;
+		SdePipeline::copyPipelineConfigInfo(configInfo, variantConfig);
+
+		std::vector<SdePipelineHandle> handles(m_VariantCount);
+		for (uint32_t i = 0; i < m_VariantCount; i++) {
+			variantConfig.specialization = configInfo.specialization;
+			variantConfig.specialization.merge(getConstants(i));
+			handles[i] = registry.request(vertexCode, fragmentCode, variantConfig);
+		}
+		return handles;
+	}
+
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "sde_pipeline.h"
+#include "sde_pipeline_registry.h"
+
+#include <string>
+#include <vector>
+
+namespace sde {
+
+	// constant_id values declared by the shaders in shaders/
+	struct SdeShaderConstantIds {
+		static constexpr uint32_t GRAYSCALE = 0; // shader.frag, bool
+	};
+
+	// Options backed by specialization constants, e.g. lighting model x alpha test.
+	// Every combination is a variant of the same SPIR-V, compiled into its own pipeline so the
+	// driver folds the option away instead of the shader branching on it at runtime.
+	class SdeShaderVariantSet {
+	public:
+		// Upper bound on the combinations, each one is a full pipeline
+		static constexpr uint32_t MAX_VARIANTS = 256;
+
+		SdeShaderVariantSet& addOption(const std::string& name, uint32_t constantId, const std::vector<uint32_t>& values);
+
+		uint32_t getVariantCount() const { return m_VariantCount; }
+		// values holds one value per option, in the order the options were added
+		uint32_t getVariantIndex(const std::vector<uint32_t>& values) const;
+		SdeSpecializationConstants getConstants(uint32_t variantIndex) const;
+
+		// Requests every variant on top of configInfo.specialization, indexed by variant index
+		std::vector<SdePipelineHandle> request(
+			SdePipelineRegistry& registry,
+			SdeShaderCode vertexCode,
+			SdeShaderCode fragmentCode,
+			const PipelineConfigInfo& configInfo) const;
+
+	private:
+		struct Option {
+			std::string name;
+			uint32_t constantId;
+			std::vector<uint32_t> values;
+		};
+
+		// The first option varies fastest in the variant index
+		std::vector<Option> m_Options;
+		uint32_t m_VariantCount = 1;
+	};
+
+}
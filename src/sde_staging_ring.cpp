@@ -0,0 +1,74 @@
+#include "sde_staging_ring.h"
+
+namespace sde {
+
+	static vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	SdeStagingRing::SdeStagingRing(SdeDevice& device, vk::DeviceSize capacity) : m_Device(device), m_Capacity(capacity)
+	{
+		m_Buffer = std::make_unique<SdeBuffer>(m_Device, capacity,
+			vk::BufferUsageFlagBits::eTransferSrc,
+			vma::AllocationCreateFlagBits::eHostAccessSequentialWrite | vma::AllocationCreateFlagBits::eMapped);
+
+		m_MappedData = static_cast<uint8_t*>(m_Buffer->getAllocationInfo().pMappedData);
+	}
+
+	std::optional<SdeStagingAllocation> SdeStagingRing::allocate(vk::DeviceSize size, vk::DeviceSize alignment, uint64_t retireId)
+	{
+		if (size == 0 || size > m_Capacity) return std::nullopt;
+
+		// Start from the beginning whenever the ring drained, keeps big requests contiguous
+		if (m_Used == 0) {
+			m_Head = 0;
+			m_Tail = 0;
+		}
+
+		vk::DeviceSize offset = alignUp(m_Head, alignment);
+		if (offset + size > m_Capacity) {
+			offset = 0; // Skip the tail end and wrap around
+		}
+
+		// Padding (or the skipped tail end) is accounted to the region so it is released with it.
+		// When wrapping, fitting in the used budget also means not overlapping the oldest live region.
+		vk::DeviceSize waste = offset >= m_Head ? offset - m_Head : m_Capacity - m_Head;
+		if (m_Used + waste + size > m_Capacity) return std::nullopt;
+
+		m_Head = offset + size;
+		m_Used += waste + size;
+
+		if (!m_Regions.empty() && m_Regions.back().retireId == retireId) {
+			m_Regions.back().size += waste + size;
+		}
+		else {
+			m_Regions.push_back({ retireId, waste + size });
+		}
+
+		SdeStagingAllocation allocation;
+		allocation.buffer = m_Buffer->getBuffer();
+		allocation.offset = offset;
+		allocation.size = size;
+		allocation.mappedData = m_MappedData + offset;
+		return allocation;
+	}
+
+	void SdeStagingRing::retire(uint64_t completedId)
+	{
+		while (!m_Regions.empty() && m_Regions.front().retireId <= completedId) {
+			auto& region = m_Regions.front();
+
+			m_Tail = (m_Tail + region.size) % m_Capacity;
+			m_Used -= region.size;
+
+			m_Regions.pop_front();
+		}
+	}
+
+	void SdeStagingRing::flush(const SdeStagingAllocation& allocation)
+	{
+		m_Device.getAllocator().flushAllocation(m_Buffer->getAllocation(), allocation.offset, allocation.size);
+	}
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "sde_device.h"
+#include "sde_buffer.h"
+
+#include <vulkan/vulkan.hpp>
+#include <deque>
+#include <memory>
+#include <optional>
+
+namespace sde {
+
+	struct SdeStagingAllocation {
+		vk::Buffer buffer;
+		vk::DeviceSize offset = 0;
+		vk::DeviceSize size = 0;
+		void* mappedData = nullptr;
+	};
+
+	// One persistently mapped host buffer, suballocated front to back and wrapping around.
+	// Every region is tagged with a retire id (an upload batch), and it is reused once that id completed.
+	class SdeStagingRing {
+	public:
+		static constexpr vk::DeviceSize DEFAULT_CAPACITY = 32ull * 1024 * 1024;
+
+		SdeStagingRing(SdeDevice& device, vk::DeviceSize capacity = DEFAULT_CAPACITY);
+
+		SdeStagingRing(const SdeStagingRing&) = delete;
+		SdeStagingRing& operator=(const SdeStagingRing&) = delete;
+
+		// Returns nothing when there is no room until older regions retire
+		std::optional<SdeStagingAllocation> allocate(vk::DeviceSize size, vk::DeviceSize alignment, uint64_t retireId);
+		void retire(uint64_t completedId);
+
+		// Makes host writes visible when the memory is not coherent
+		void flush(const SdeStagingAllocation& allocation);
+
+		vk::DeviceSize capacity() const { return m_Capacity; }
+		vk::DeviceSize used() const { return m_Used; }
+
+	private:
+		struct Region {
+			uint64_t retireId;
+			vk::DeviceSize size; // Includes alignment padding and space skipped when wrapping
+		};
+
+		SdeDevice& m_Device;
+		std::unique_ptr<SdeBuffer> m_Buffer;
+		uint8_t* m_MappedData = nullptr;
+
+		vk::DeviceSize m_Capacity;
+		vk::DeviceSize m_Head = 0;
+		vk::DeviceSize m_Tail = 0;
+		vk::DeviceSize m_Used = 0;
+
+		std::deque<Region> m_Regions;
+	};
+
+}
@@ -1,77 +1,136 @@
 #include "sde_swap_chain.h"
+#include "sde_trace.h"
+#include "sde_timeline.h"
+#include "sde_deletion_queue.h"
 
 namespace sde {
 
-	SdeSwapChain::SdeSwapChain(SdeDevice& device, vk::Extent2D windowExtent) : m_Device(device), m_WindowExtent(windowExtent)
+	bool SdeSwapChainConfig::parsePresentMode(const std::string& name, vk::PresentModeKHR& mode)
+	{
+		if (name == "immediate") mode = vk::PresentModeKHR::eImmediate;
+		else if (name == "mailbox") mode = vk::PresentModeKHR::eMailbox;
+		else if (name == "fifo") mode = vk::PresentModeKHR::eFifo;
+		else if (name == "fifo-relaxed") mode = vk::PresentModeKHR::eFifoRelaxed;
+		else return false;
+
+		return true;
+	}
+
+	SdeSwapChain::SdeSwapChain(SdeDevice& device, vk::Extent2D windowExtent, const SdeSwapChainConfig& config) : m_Device(device), m_WindowExtent(windowExtent), m_Config(config)
 	{
 		init();
 	}
 
-	SdeSwapChain::SdeSwapChain(SdeDevice& device, vk::Extent2D windowExtent, std::shared_ptr<SdeSwapChain> oldSwapChain) : m_Device(device), m_WindowExtent(windowExtent), m_OldSwapChain(oldSwapChain)
+	SdeSwapChain::SdeSwapChain(SdeDevice& device, vk::Extent2D windowExtent, const SdeSwapChainConfig& config, std::shared_ptr<SdeSwapChain> oldSwapChain) : m_Device(device), m_WindowExtent(windowExtent), m_Config(config), m_OldSwapChain(oldSwapChain)
 	{
 		init();
-		m_OldSwapChain = nullptr;
+
+		// Nothing is presented when headless, submits alone are tracked by the deletion queue
+		if (m_Device.isHeadless()) {
+			m_OldSwapChain = nullptr;
+		}
 	}
 
 	SdeSwapChain::~SdeSwapChain()
 	{
-		for (auto imageView : m_SwapChainImageViews) {
-			m_Device.device().destroyImageView(imageView);
-		}
-		m_SwapChainImageViews.clear();
+		// Frames in flight may still render to or present the images, a replaced swapchain
+		// goes once they retired instead of draining the GPU
+		vk::Device device = m_Device.device();
+		vma::Allocator allocator = m_Device.getAllocator();
+		m_Device.deletionQueue().push([device, allocator,
+			imageViews = std::move(m_SwapChainImageViews),
+			swapChain = m_SwapChain,
+			images = std::move(m_SwapChainImages),
+			offscreenAllocations = std::move(m_OffscreenAllocations),
+			framebuffers = std::move(m_Framebuffers),
+			renderPass = m_RenderPass,
+			imageSemaphores = std::move(m_ImageSemaphores),
+			renderFinishedSemaphores = std::move(m_RenderFinishedSemaphores)]() {
+			for (auto imageView : imageViews) {
+				device.destroyImageView(imageView);
+			}
 
-		if (m_SwapChain) {
-			m_Device.device().destroySwapchainKHR(m_SwapChain);
-			m_SwapChain = nullptr;
-		}
+			if (swapChain) {
+				device.destroySwapchainKHR(swapChain);
+			}
 
-		for (auto framebuffer : m_Framebuffers) {
-			m_Device.device().destroyFramebuffer(framebuffer);
-		}
+			for (size_t i = 0; i < offscreenAllocations.size(); i++) {
+				allocator.destroyImage(images[i], offscreenAllocations[i]);
+			}
+
+			for (auto framebuffer : framebuffers) {
+				device.destroyFramebuffer(framebuffer);
+			}
 
-		m_Device.device().destroyRenderPass(m_RenderPass);
+			// Null when a newer swapchain took it over
+			if (renderPass) {
+				device.destroyRenderPass(renderPass);
+			}
 
-		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-			m_Device.device().destroySemaphore(m_ImageSemaphores[i]);
-			m_Device.device().destroySemaphore(m_RenderFinishedSemaphores[i]);
-			m_Device.device().destroyFence(m_InFlightFences[i]);
-		}
+			for (auto semaphore : imageSemaphores) {
+				device.destroySemaphore(semaphore);
+			}
+			for (auto semaphore : renderFinishedSemaphores) {
+				device.destroySemaphore(semaphore);
+			}
+		});
 	}
 
-	vk::ResultValue<uint32_t> SdeSwapChain::acquireNextImage()
+	vk::ResultValue<uint32_t> SdeSwapChain::acquireNextImage(uint32_t frameIndex)
 	{
-		m_Device.device().waitForFences(1, &m_InFlightFences[m_CurrentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
+		SDE_TRACE_FUNCTION();
+
+		// Offscreen images are owned per frame, retiring the frame already freed it
+		if (m_Device.isHeadless()) {
+			return vk::ResultValue<uint32_t>(vk::Result::eSuccess, frameIndex);
+		}
 
-		return m_Device.device().acquireNextImageKHR(m_SwapChain, std::numeric_limits<uint64_t>::max(), m_ImageSemaphores[m_CurrentFrame], nullptr);
+		auto result = m_Device.device().acquireNextImageKHR(m_SwapChain, std::numeric_limits<uint64_t>::max(), m_ImageSemaphores[frameIndex], nullptr);
+
+		// With more images than frames in flight an image can come back while its last frame is still running.
+		// Usually that frame already retired and this returns right away.
+		if (result.result == vk::Result::eSuccess || result.result == vk::Result::eSuboptimalKHR) {
+			SDE_TRACE_ZONE("WaitForImage");
+			m_Device.timeline().wait(m_ImageValues[result.value]);
+
+			// An image presented by this swapchain came back, so that present waited on its semaphore.
+			// Presents complete in order, those of the old swapchain are done with its semaphores too.
+			if (m_OldSwapChain && m_ImageValues[result.value] != 0) {
+				m_OldSwapChain = nullptr;
+			}
+		}
+
+		return result;
 	}
 
-	vk::Result SdeSwapChain::submitCommandBuffers(const vk::CommandBuffer* buffers, uint32_t imageIndex)
+	vk::ResultValue<uint64_t> SdeSwapChain::submitCommandBuffers(const vk::CommandBuffer* buffers, uint32_t imageIndex, uint32_t frameIndex)
 	{
-		m_Device.device().waitForFences(1, &m_InFlightFences[m_CurrentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
+		SDE_TRACE_FUNCTION();
+
+		bool headless = m_Device.isHeadless();
 
 		vk::SubmitInfo submitInfo = {};
-		vk::Semaphore waitSemaphores[] = { m_ImageSemaphores[m_CurrentFrame] };
+		vk::Semaphore waitSemaphores[] = { m_ImageSemaphores[frameIndex] };
 		vk::PipelineStageFlags waitStages[] = { vk::PipelineStageFlagBits::eColorAttachmentOutput };
 
-		submitInfo.waitSemaphoreCount = 1;
+		// Nothing to acquire or present when headless
+		submitInfo.waitSemaphoreCount = headless ? 0 : 1;
 		submitInfo.pWaitSemaphores = waitSemaphores;
 		submitInfo.pWaitDstStageMask = waitStages;
 
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = buffers;
 
-		vk::Semaphore signalSemaphores[] = { m_RenderFinishedSemaphores[m_CurrentFrame] };
-		submitInfo.signalSemaphoreCount = 1;
+		vk::Semaphore signalSemaphores[] = { m_RenderFinishedSemaphores[imageIndex] };
+		submitInfo.signalSemaphoreCount = headless ? 0 : 1;
 		submitInfo.pSignalSemaphores = signalSemaphores;
 
-		m_Device.device().resetFences(1, &m_InFlightFences[m_CurrentFrame]);
-
 		// Submit to graphics queue
-		try {
-			m_Device.graphicsQueue().submit(submitInfo, m_InFlightFences[m_CurrentFrame]);
-		}
-		catch (vk::SystemError err) {
-			throw std::runtime_error("Failed to submit draw command buffer");
+		uint64_t submitValue = m_Device.timeline().submit(submitInfo);
+		m_ImageValues[imageIndex] = submitValue;
+
+		if (headless) {
+			return vk::ResultValue<uint64_t>(vk::Result::eSuccess, submitValue);
 		}
 
 		vk::PresentInfoKHR presentInfo = {};
@@ -83,6 +142,8 @@ namespace sde {
 		presentInfo.pSwapchains = swapChains;
 		presentInfo.pImageIndices = &imageIndex;
 
+		SDE_TRACE_ZONE("Present");
+
 		vk::Result resultPresent;
 		try {
 			resultPresent = m_Device.presentQueue().presentKHR(presentInfo);
@@ -90,17 +151,33 @@ namespace sde {
 		catch (vk::OutOfDateKHRError err) {
 			resultPresent = vk::Result::eErrorOutOfDateKHR;
 		}
-		
-		m_CurrentFrame = (m_CurrentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 
-		return resultPresent;
+		return vk::ResultValue<uint64_t>(resultPresent, submitValue);
 	}
 
 	void SdeSwapChain::init()
 	{
-		createSwapChain();
+		if (m_Config.framesInFlight < 1 || m_Config.framesInFlight > MAX_FRAMES_IN_FLIGHT) {
+			throw std::runtime_error("Frames in flight must be between 1 and MAX_FRAMES_IN_FLIGHT");
+		}
+
+		if (m_Device.isHeadless()) {
+			createOffscreenImages();
+		}
+		else {
+			createSwapChain();
+		}
 		createImageViews();
-		createRenderPass();
+
+		// Same format, same render pass. It moves over instead of being rebuilt, so pipelines built
+		// against it stay valid and the old swapchain's frames in flight keep using a live object.
+		if (m_OldSwapChain && m_OldSwapChain->m_RenderPass && compareSwapFormats(*m_OldSwapChain)) {
+			m_RenderPass = m_OldSwapChain->m_RenderPass;
+			m_OldSwapChain->m_RenderPass = nullptr;
+		}
+		else {
+			createRenderPass();
+		}
 		createFramebuffers();
 		createSyncObjects();
 	}
@@ -113,7 +190,11 @@ namespace sde {
 		auto presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
 		auto extent = chooseSwapExtent(swapChainSupport.capabilities);
 
-		uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1; // Request 1 more to avoid waiting
+		uint32_t imageCount = m_Config.imageCount;
+		if (imageCount == 0) {
+			imageCount = swapChainSupport.capabilities.minImageCount + 1; // Request 1 more to avoid waiting
+		}
+		imageCount = std::max(imageCount, swapChainSupport.capabilities.minImageCount);
 		if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
 			imageCount = swapChainSupport.capabilities.maxImageCount;
 		}
@@ -158,6 +239,37 @@ namespace sde {
 		m_SwapChainImages = m_Device.device().getSwapchainImagesKHR(m_SwapChain);
 		m_SwapChainImageFormat = surfaceFormat.format;
 		m_SwapChainExtent = extent;
+		m_PresentMode = presentMode;
+	}
+
+	void SdeSwapChain::createOffscreenImages()
+	{
+		// One color image per frame in flight, rendered to and never presented
+		m_SwapChainImageFormat = vk::Format::eB8G8R8A8Unorm;
+		m_SwapChainExtent = m_WindowExtent;
+
+		vk::ImageCreateInfo imageInfo = {};
+		imageInfo.imageType = vk::ImageType::e2D;
+		imageInfo.format = m_SwapChainImageFormat;
+		imageInfo.extent = vk::Extent3D(m_SwapChainExtent.width, m_SwapChainExtent.height, 1);
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = vk::SampleCountFlagBits::e1;
+		imageInfo.tiling = vk::ImageTiling::eOptimal;
+		imageInfo.usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc;
+		imageInfo.sharingMode = vk::SharingMode::eExclusive;
+		imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+
+		vma::AllocationCreateInfo allocationInfo(vma::AllocationCreateFlags(), vma::MemoryUsage::eAutoPreferDevice);
+
+		m_SwapChainImages.resize(m_Config.framesInFlight);
+		m_OffscreenAllocations.resize(m_Config.framesInFlight);
+
+		for (size_t i = 0; i < m_Config.framesInFlight; i++) {
+			auto image = m_Device.getAllocator().createImage(imageInfo, allocationInfo);
+			m_SwapChainImages[i] = image.first;
+			m_OffscreenAllocations[i] = image.second;
+		}
 	}
 
 	void SdeSwapChain::createImageViews()
@@ -195,7 +307,7 @@ namespace sde {
 		colorAttachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
 		colorAttachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
 		colorAttachment.initialLayout = vk::ImageLayout::eUndefined;
-		colorAttachment.finalLayout = vk::ImageLayout::ePresentSrcKHR;
+		colorAttachment.finalLayout = m_Device.isHeadless() ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::ePresentSrcKHR;
 
 		vk::AttachmentReference colorAttachmentRef = {};
 		colorAttachmentRef.attachment = 0;
@@ -248,15 +360,18 @@ namespace sde {
 
 	void SdeSwapChain::createSyncObjects()
 	{
-		m_ImageSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-		m_RenderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-		m_InFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-
-		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+		m_ImageSemaphores.resize(m_Config.framesInFlight);
+		for (size_t i = 0; i < m_Config.framesInFlight; i++) {
 			m_ImageSemaphores[i] = m_Device.device().createSemaphore(vk::SemaphoreCreateInfo());
+		}
+
+		m_RenderFinishedSemaphores.resize(m_SwapChainImages.size());
+		for (size_t i = 0; i < m_SwapChainImages.size(); i++) {
 			m_RenderFinishedSemaphores[i] = m_Device.device().createSemaphore(vk::SemaphoreCreateInfo());
-			m_InFlightFences[i] = m_Device.device().createFence(vk::FenceCreateInfo({ vk::FenceCreateFlagBits::eSignaled }));
 		}
+
+		// Nothing rendered to the new images yet
+		m_ImageValues.assign(m_SwapChainImages.size(), 0);
 	}
 
 	vk::SurfaceFormatKHR SdeSwapChain::chooseSwapSurfaceFormat(const std::vector<vk::SurfaceFormatKHR>& availableFormats)
@@ -274,13 +389,13 @@ namespace sde {
 	{
 		for (const auto& availablePresentMode : availablePresentModes)
 		{
-			if (availablePresentMode == vk::PresentModeKHR::eMailbox) {
-				std::cout << "Present mode: Mailbox\n";
+			if (availablePresentMode == m_Config.presentMode) {
+				std::cout << "Present mode: " << vk::to_string(availablePresentMode) << "\n";
 				return availablePresentMode;
 			}
 		}
 
-		std::cout << "Present mode: V-Sync\n";
+		std::cout << "Present mode: " << vk::to_string(m_Config.presentMode) << " unsupported, using V-Sync\n";
 		return vk::PresentModeKHR::eFifo;
 	}
 
@@ -9,12 +9,27 @@
 
 namespace sde {
 
+	struct SdeSwapChainConfig {
+		// 1 to SdeSwapChain::MAX_FRAMES_IN_FLIGHT, more trades latency for throughput
+		uint32_t framesInFlight = 2;
+		// 0 requests one more than the surface minimum, clamped to what the surface supports
+		uint32_t imageCount = 0;
+		// Falls back to FIFO, the only mode every surface supports
+		vk::PresentModeKHR presentMode = vk::PresentModeKHR::eMailbox;
+
+		// immediate, mailbox, fifo or fifo-relaxed
+		static bool parsePresentMode(const std::string& name, vk::PresentModeKHR& mode);
+	};
+
 	class SdeSwapChain {
 	public:
-		static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+		// Upper bound of SdeSwapChainConfig::framesInFlight, per frame arrays may be sized by it
+		static constexpr int MAX_FRAMES_IN_FLIGHT = 4;
 
-		SdeSwapChain(SdeDevice& device, vk::Extent2D windowExtent);
-		SdeSwapChain(SdeDevice& device, vk::Extent2D windowExtent, std::shared_ptr<SdeSwapChain> oldSwapChain);
+		SdeSwapChain(SdeDevice& device, vk::Extent2D windowExtent, const SdeSwapChainConfig& config = {});
+		// Takes over the render pass of oldSwapChain when the format is unchanged.
+		// Keeps oldSwapChain until an image of this one is acquired again, its presents are done by then.
+		SdeSwapChain(SdeDevice& device, vk::Extent2D windowExtent, const SdeSwapChainConfig& config, std::shared_ptr<SdeSwapChain> oldSwapChain);
 
 		~SdeSwapChain();
 
@@ -22,6 +37,7 @@ namespace sde {
 		SdeSwapChain& operator=(const SdeSwapChain&) = delete;
 
 		vk::Framebuffer getFramebuffer(int index) { return m_Framebuffers[index]; }
+		vk::Image getImage(int index) { return m_SwapChainImages[index]; }
 		vk::RenderPass getRenderPass() { return m_RenderPass; }
 		vk::ImageView getImageView(int index) { return m_SwapChainImageViews[index]; }
 		vk::Format getSwapChainImageFormat() { return m_SwapChainImageFormat; }
@@ -31,8 +47,15 @@ namespace sde {
 		uint32_t getHeight() { return m_SwapChainExtent.height; }
 		float getAspectRatio() { return (float)getWidth() / (float)getHeight(); }
 
-		vk::ResultValue<uint32_t> acquireNextImage();
-		vk::Result submitCommandBuffers(const vk::CommandBuffer* buffers, uint32_t imageIndex);
+		uint32_t getImageCount() const { return static_cast<uint32_t>(m_SwapChainImages.size()); }
+		// The mode in use, which differs from the requested one when the surface lacks it
+		vk::PresentModeKHR getPresentMode() const { return m_PresentMode; }
+
+		// frameIndex is owned by SdeRenderer, the caller must have waited for that frame to retire.
+		// Also waits for the last frame that rendered to the returned image, if it is still in flight.
+		vk::ResultValue<uint32_t> acquireNextImage(uint32_t frameIndex);
+		// Submits through the device timeline and presents, the value is the timeline value of the submit
+		vk::ResultValue<uint64_t> submitCommandBuffers(const vk::CommandBuffer* buffers, uint32_t imageIndex, uint32_t frameIndex);
 
 		bool compareSwapFormats(const SdeSwapChain& swapChain) const {
 			return swapChain.m_SwapChainImageFormat == m_SwapChainImageFormat;
@@ -41,6 +64,7 @@ namespace sde {
 	private:
 		void init();
 		void createSwapChain();
+		void createOffscreenImages();
 		void createImageViews();
 		void createRenderPass();
 		void createFramebuffers();
@@ -52,28 +76,34 @@ namespace sde {
 		vk::Extent2D chooseSwapExtent(const vk::SurfaceCapabilitiesKHR& capabilities);
 
 	private:
-		uint32_t m_CurrentFrame = 0;
-
 		SdeDevice& m_Device;
 		vk::Extent2D m_WindowExtent;
+		SdeSwapChainConfig m_Config;
+		vk::PresentModeKHR m_PresentMode = vk::PresentModeKHR::eFifo;
 		vk::RenderPass m_RenderPass;
 
 		vk::SwapchainKHR m_SwapChain;
+		// Held until the presentation engine released the old semaphores, see acquireNextImage
 		std::shared_ptr<SdeSwapChain> m_OldSwapChain;
 
 		vk::Extent2D m_SwapChainExtent;
 		std::vector<vk::Image> m_SwapChainImages;
 		std::vector<vk::ImageView> m_SwapChainImageViews;
 
+		// Headless only: VMA backing for the offscreen color images
+		std::vector<vma::Allocation> m_OffscreenAllocations;
+
 		vk::Format m_SwapChainImageFormat;
 
 		// Framebuffers
 		std::vector<vk::Framebuffer> m_Framebuffers;
 
-		// Fences & Semaphores
+		// Per frame in flight
 		std::vector<vk::Semaphore> m_ImageSemaphores;
+		// Per image, presentation may still hold the semaphore of an image after its frame retired
 		std::vector<vk::Semaphore> m_RenderFinishedSemaphores;
-		std::vector<vk::Fence> m_InFlightFences;
+		// Timeline value of the last submit that rendered to each image
+		std::vector<uint64_t> m_ImageValues;
 	};
 
 }
\ No newline at end of file
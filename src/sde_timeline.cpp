@@ -0,0 +1,156 @@
+#include "sde_timeline.h"
+#include "sde_device.h"
+#include "sde_trace.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace sde {
+
+	SdeTimeline::SdeTimeline(SdeDevice& device) : m_Device(device)
+	{
+		if (!m_Device.supportsTimelineSemaphores()) return;
+
+		vk::SemaphoreTypeCreateInfoKHR typeInfo = {};
+		typeInfo.semaphoreType = vk::SemaphoreTypeKHR::eTimeline;
+		typeInfo.initialValue = 0;
+
+		vk::SemaphoreCreateInfo createInfo = {};
+		createInfo.pNext = &typeInfo;
+
+		m_Semaphore = m_Device.device().createSemaphore(createInfo);
+	}
+
+	SdeTimeline::~SdeTimeline()
+	{
+		waitIdle();
+
+		if (m_Semaphore) {
+			m_Device.device().destroySemaphore(m_Semaphore);
+		}
+
+		for (auto& pending : m_PendingFences) {
+			m_Device.device().destroyFence(pending.fence);
+		}
+		for (auto fence : m_FreeFences) {
+			m_Device.device().destroyFence(fence);
+		}
+	}
+
+	uint64_t SdeTimeline::submit(const vk::SubmitInfo& submitInfo)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		uint64_t value = m_LastSubmitted.load(std::memory_order_relaxed) + 1;
+
+		try {
+			if (m_Semaphore) {
+				// Our semaphore goes after the caller's, binary semaphores ignore their values
+				std::vector<vk::Semaphore> signalSemaphores(submitInfo.pSignalSemaphores, submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount);
+				signalSemaphores.push_back(m_Semaphore);
+				std::vector<uint64_t> signalValues(signalSemaphores.size(), 0);
+				signalValues.back() = value;
+				std::vector<uint64_t> waitValues(submitInfo.waitSemaphoreCount, 0);
+
+				vk::TimelineSemaphoreSubmitInfoKHR timelineInfo = {};
+				timelineInfo.pNext = submitInfo.pNext;
+				timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+				timelineInfo.pWaitSemaphoreValues = waitValues.data();
+				timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+				timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+				vk::SubmitInfo timelineSubmit = submitInfo;
+				timelineSubmit.pNext = &timelineInfo;
+				timelineSubmit.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+				timelineSubmit.pSignalSemaphores = signalSemaphores.data();
+
+				m_Device.graphicsQueue().submit(timelineSubmit, nullptr);
+			}
+			else {
+				vk::Fence fence;
+				if (!m_FreeFences.empty()) {
+					fence = m_FreeFences.back();
+					m_FreeFences.pop_back();
+				}
+				else {
+					fence = m_Device.device().createFence(vk::FenceCreateInfo());
+				}
+
+				m_Device.graphicsQueue().submit(submitInfo, fence);
+				m_PendingFences.push_back({ value, fence });
+			}
+		}
+		catch (vk::SystemError err) {
+			throw std::runtime_error("Failed to submit to the graphics queue");
+		}
+
+		m_LastSubmitted.store(value, std::memory_order_release);
+		return value;
+	}
+
+	uint64_t SdeTimeline::getCompletedValue()
+	{
+		if (m_Semaphore) {
+			uint64_t value = 0;
+			m_Device.getSemaphoreCounterValueFn()(m_Device.device(), m_Semaphore, &value);
+
+			// Concurrent pollers must not move it backwards
+			uint64_t completed = m_Completed.load(std::memory_order_relaxed);
+			while (completed < value && !m_Completed.compare_exchange_weak(completed, value, std::memory_order_release)) {}
+			return std::max(completed, value);
+		}
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		pollFencesLocked();
+		return m_Completed.load(std::memory_order_acquire);
+	}
+
+	bool SdeTimeline::isComplete(uint64_t value)
+	{
+		if (value <= m_Completed.load(std::memory_order_acquire)) return true;
+		return value <= getCompletedValue();
+	}
+
+	void SdeTimeline::wait(uint64_t value)
+	{
+		if (value == 0 || value <= m_Completed.load(std::memory_order_acquire)) return;
+		value = std::min(value, getLastSubmittedValue());
+
+		SDE_TRACE_FUNCTION();
+
+		if (m_Semaphore) {
+			vk::SemaphoreWaitInfoKHR waitInfo = {};
+			waitInfo.semaphoreCount = 1;
+			waitInfo.pSemaphores = &m_Semaphore;
+			waitInfo.pValues = &value;
+
+			m_Device.waitSemaphoresFn()(m_Device.device(), reinterpret_cast<const VkSemaphoreWaitInfo*>(&waitInfo), std::numeric_limits<uint64_t>::max());
+			getCompletedValue();
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		for (auto& pending : m_PendingFences) {
+			if (pending.value < value) continue;
+
+			// Later submissions finish after earlier ones, the first fence at or past value covers it
+			m_Device.device().waitForFences(1, &pending.fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+			break;
+		}
+		pollFencesLocked();
+	}
+
+	void SdeTimeline::pollFencesLocked()
+	{
+		while (!m_PendingFences.empty()) {
+			auto& pending = m_PendingFences.front();
+			if (m_Device.device().getFenceStatus(pending.fence) != vk::Result::eSuccess) break;
+
+			m_Completed.store(pending.value, std::memory_order_release);
+			m_Device.device().resetFences(pending.fence);
+			m_FreeFences.push_back(pending.fence);
+			m_PendingFences.pop_front();
+		}
+	}
+
+}
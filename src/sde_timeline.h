@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace sde {
+
+	class SdeDevice;
+
+	// Monotonic progress of the graphics queue. Every submit through it signals the next value,
+	// so anything tagged with a value can be retired once getCompletedValue() reached it.
+	// Backed by a timeline semaphore when the device supports them, otherwise by a fence per submit.
+	class SdeTimeline {
+	public:
+		SdeTimeline(SdeDevice& device);
+		~SdeTimeline();
+
+		SdeTimeline(const SdeTimeline&) = delete;
+		SdeTimeline& operator=(const SdeTimeline&) = delete;
+
+		// Submits to the graphics queue and returns the value signaled once it completed.
+		// Binary semaphores in submitInfo are kept. Submits from several threads are serialized.
+		uint64_t submit(const vk::SubmitInfo& submitInfo);
+
+		uint64_t getLastSubmittedValue() const { return m_LastSubmitted.load(std::memory_order_acquire); }
+		// Polls, cheap enough to call every frame
+		uint64_t getCompletedValue();
+		bool isComplete(uint64_t value);
+
+		// Returns immediately for values that already completed, or that were never submitted
+		void wait(uint64_t value);
+		void waitIdle() { wait(getLastSubmittedValue()); }
+
+		bool usesTimelineSemaphore() const { return static_cast<bool>(m_Semaphore); }
+
+	private:
+		struct PendingFence {
+			uint64_t value;
+			vk::Fence fence;
+		};
+
+		void pollFencesLocked();
+
+	private:
+		SdeDevice& m_Device;
+		std::mutex m_Mutex;
+
+		std::atomic<uint64_t> m_LastSubmitted{ 0 };
+		std::atomic<uint64_t> m_Completed{ 0 };
+
+		vk::Semaphore m_Semaphore;
+
+		// Fence fallback, submissions retire in order on the one queue
+		std::deque<PendingFence> m_PendingFences;
+		std::vector<vk::Fence> m_FreeFences;
+	};
+
+}
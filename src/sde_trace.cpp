@@ -0,0 +1,122 @@
+#include "sde_trace.h"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+namespace sde {
+
+	namespace {
+		struct TraceRegistry {
+			std::mutex mutex;
+			std::vector<std::unique_ptr<SdeTraceBuffer>> buffers;
+			std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+		};
+
+		// Never destroyed, threads may still trace during static destruction
+		TraceRegistry& registry()
+		{
+			static TraceRegistry* instance = new TraceRegistry();
+			return *instance;
+		}
+
+		void writeEscaped(std::ostream& out, const std::string& value)
+		{
+			for (char c : value) {
+				switch (c) {
+				case '"': out << "\\\""; break;
+				case '\\': out << "\\\\"; break;
+				case '\n': out << "\\n"; break;
+				default:
+					if (static_cast<unsigned char>(c) >= 0x20) out << c;
+				}
+			}
+		}
+	}
+
+	uint64_t SdeTrace::now()
+	{
+		auto elapsed = std::chrono::steady_clock::now() - registry().epoch;
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+	}
+
+	SdeTraceBuffer& SdeTrace::threadBuffer()
+	{
+		// Registration is the only locked path, once per thread
+		thread_local SdeTraceBuffer* buffer = nullptr;
+		if (buffer == nullptr) {
+			auto& traceRegistry = registry();
+			std::lock_guard<std::mutex> lock(traceRegistry.mutex);
+
+			uint32_t threadId = static_cast<uint32_t>(traceRegistry.buffers.size()) + 1;
+			traceRegistry.buffers.push_back(std::make_unique<SdeTraceBuffer>(threadId));
+			buffer = traceRegistry.buffers.back().get();
+		}
+		return *buffer;
+	}
+
+	void SdeTrace::setThreadName(const std::string& name)
+	{
+		auto& buffer = threadBuffer();
+
+		std::lock_guard<std::mutex> lock(registry().mutex);
+		buffer.threadName = name;
+	}
+
+	bool SdeTrace::dump(const std::string& path)
+	{
+		std::ofstream file(path);
+		if (!file.is_open()) {
+			std::cerr << "Failed to open trace file: " << path << std::endl;
+			return false;
+		}
+
+		auto& traceRegistry = registry();
+		std::lock_guard<std::mutex> lock(traceRegistry.mutex);
+
+		file << std::fixed << std::setprecision(3);
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+		bool first = true;
+		uint64_t dropped = 0;
+
+		for (const auto& buffer : traceRegistry.buffers) {
+			dropped += buffer->dropped();
+
+			if (!buffer->threadName.empty()) {
+				file << (first ? "" : ",\n");
+				file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId() << ",\"args\":{\"name\":\"";
+				writeEscaped(file, buffer->threadName);
+				file << "\"}}";
+				first = false;
+			}
+
+			size_t count = buffer->size();
+			for (size_t i = 0; i < count; i++) {
+				const auto& event = buffer->at(i);
+
+				// Timestamps are microseconds in the trace format
+				file << (first ? "" : ",\n");
+				file << "{\"name\":\"";
+				writeEscaped(file, event.name);
+				file << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId()
+					<< ",\"ts\":" << static_cast<double>(event.startNs) / 1000.0
+					<< ",\"dur\":" << static_cast<double>(event.durationNs) / 1000.0 << "}";
+				first = false;
+			}
+		}
+
+		file << "\n]}\n";
+
+		if (dropped > 0) {
+			std::cerr << "Trace buffers were full, " << dropped << " events dropped" << std::endl;
+		}
+
+		std::cout << "Trace written to " << path << std::endl;
+		return true;
+	}
+
+}
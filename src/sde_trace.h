@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// CPU zone tracing, exported as Chrome/Perfetto trace JSON.
+// Zones compile to nothing unless SDE_ENABLE_TRACING is defined (CMake option of the same name).
+// Zone names must be string literals, only the pointer is stored.
+#ifdef SDE_ENABLE_TRACING
+	#define SDE_TRACE_CONCAT_INNER(a, b) a##b
+	#define SDE_TRACE_CONCAT(a, b) SDE_TRACE_CONCAT_INNER(a, b)
+	#define SDE_TRACE_ZONE(name) ::sde::SdeTraceZone SDE_TRACE_CONCAT(sdeTraceZone, __LINE__)(name)
+	#define SDE_TRACE_FUNCTION() SDE_TRACE_ZONE(__FUNCTION__)
+	#define SDE_TRACE_THREAD_NAME(name) ::sde::SdeTrace::setThreadName(name)
+	#define SDE_TRACE_DUMP(path) ::sde::SdeTrace::dump(path)
+#else
+	#define SDE_TRACE_ZONE(name) ((void)0)
+	#define SDE_TRACE_FUNCTION() ((void)0)
+	#define SDE_TRACE_THREAD_NAME(name) ((void)0)
+	#define SDE_TRACE_DUMP(path) ((void)0)
+#endif
+
+namespace sde {
+
+	struct SdeTraceEvent {
+		const char* name;
+		uint64_t startNs;
+		uint64_t durationNs;
+	};
+
+	// Events of a single thread. Only the owning thread writes, so appending is lock-free;
+	// readers see every event below the published count.
+	class SdeTraceBuffer {
+	public:
+		static constexpr size_t CAPACITY = 1 << 18;
+
+		SdeTraceBuffer(uint32_t threadId) : m_ThreadId(threadId), m_Events(new SdeTraceEvent[CAPACITY]) {}
+
+		void push(const SdeTraceEvent& event) {
+			size_t count = m_Count.load(std::memory_order_relaxed);
+			if (count >= CAPACITY) {
+				m_Dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			m_Events[count] = event;
+			m_Count.store(count + 1, std::memory_order_release);
+		}
+
+		size_t size() const { return m_Count.load(std::memory_order_acquire); }
+		const SdeTraceEvent& at(size_t index) const { return m_Events[index]; }
+		uint64_t dropped() const { return m_Dropped.load(std::memory_order_relaxed); }
+		uint32_t threadId() const { return m_ThreadId; }
+
+		std::string threadName;
+
+	private:
+		uint32_t m_ThreadId;
+		std::unique_ptr<SdeTraceEvent[]> m_Events;
+		std::atomic<size_t> m_Count{ 0 };
+		std::atomic<uint64_t> m_Dropped{ 0 };
+	};
+
+	class SdeTrace {
+	public:
+		// Nanoseconds since the first traced event of the process
+		static uint64_t now();
+
+		static SdeTraceBuffer& threadBuffer();
+		static void setThreadName(const std::string& name);
+
+		// Writes every event recorded so far, safe to call while other threads keep tracing
+		static bool dump(const std::string& path);
+	};
+
+	class SdeTraceZone {
+	public:
+		SdeTraceZone(const char* name) : m_Name(name), m_Start(SdeTrace::now()) {}
+		~SdeTraceZone() {
+			SdeTrace::threadBuffer().push({ m_Name, m_Start, SdeTrace::now() - m_Start });
+		}
+
+		SdeTraceZone(const SdeTraceZone&) = delete;
+		SdeTraceZone& operator=(const SdeTraceZone&) = delete;
+
+	private:
+		const char* m_Name;
+		uint64_t m_Start;
+	};
+
+}
@@ -0,0 +1,56 @@
+#include "sde_uniform_ring.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace sde {
+
+	static vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	SdeUniformRing::SdeUniformRing(SdeDevice& device, uint32_t framesInFlight, vk::DeviceSize frameSize) : m_Device(device)
+	{
+		m_Alignment = std::max<vk::DeviceSize>(m_Device.getProperties().limits.minUniformBufferOffsetAlignment, 16);
+		m_FrameSize = alignUp(frameSize, m_Alignment);
+
+		m_Buffer = std::make_unique<SdeBuffer>(
+			m_Device,
+			m_FrameSize * framesInFlight,
+			vk::BufferUsageFlagBits::eUniformBuffer,
+			vma::AllocationCreateFlagBits::eMapped | vma::AllocationCreateFlagBits::eHostAccessSequentialWrite
+		);
+		m_MappedData = static_cast<uint8_t*>(m_Buffer->getAllocationInfo().pMappedData);
+	}
+
+	void SdeUniformRing::beginFrame(int frameIndex)
+	{
+		m_FrameBegin = m_FrameSize * static_cast<vk::DeviceSize>(frameIndex);
+		m_Head.store(m_FrameBegin, std::memory_order_relaxed);
+	}
+
+	void SdeUniformRing::flush()
+	{
+		// Failed allocations may have pushed the head past the frame
+		vk::DeviceSize head = std::min(m_Head.load(std::memory_order_relaxed), m_FrameBegin + m_FrameSize);
+		if (head == m_FrameBegin) return;
+
+		m_Device.getAllocator().flushAllocation(m_Buffer->getAllocation(), m_FrameBegin, head - m_FrameBegin);
+	}
+
+	SdeUniformAllocation SdeUniformRing::allocate(vk::DeviceSize size)
+	{
+		vk::DeviceSize alignedSize = alignUp(size, m_Alignment);
+		vk::DeviceSize head = m_Head.fetch_add(alignedSize, std::memory_order_relaxed);
+		if (head + alignedSize > m_FrameBegin + m_FrameSize) {
+			throw std::runtime_error("Uniform ring is full for this frame");
+		}
+
+		SdeUniformAllocation allocation = {};
+		allocation.data = m_MappedData + head;
+		allocation.offset = static_cast<uint32_t>(head);
+		return allocation;
+	}
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "sde_device.h"
+#include "sde_buffer.h"
+
+#include <vulkan/vulkan.hpp>
+#include <atomic>
+#include <cstring>
+#include <memory>
+
+namespace sde {
+
+	struct SdeUniformAllocation {
+		void* data = nullptr;
+		// Dynamic offset to pass to bindDescriptorSets
+		uint32_t offset = 0;
+	};
+
+	// One persistently mapped uniform buffer split in a region per frame in flight.
+	// Per draw blocks are bump allocated and bound through eUniformBufferDynamic descriptors,
+	// a single descriptor set covers every frame since the offsets are absolute.
+	class SdeUniformRing {
+	public:
+		static constexpr vk::DeviceSize DEFAULT_FRAME_SIZE = 1024 * 1024;
+
+		SdeUniformRing(SdeDevice& device, uint32_t framesInFlight, vk::DeviceSize frameSize = DEFAULT_FRAME_SIZE);
+
+		SdeUniformRing(const SdeUniformRing&) = delete;
+		SdeUniformRing& operator=(const SdeUniformRing&) = delete;
+
+		// Resets the region of frameIndex, its fence must have signaled
+		void beginFrame(int frameIndex);
+		// Makes the writes of the current frame visible to the device, before submit
+		void flush();
+
+		// Lock free, safe to call from the parallel recording threads
+		SdeUniformAllocation allocate(vk::DeviceSize size);
+
+		template<typename T>
+		uint32_t push(const T& data)
+		{
+			auto allocation = allocate(sizeof(T));
+			memcpy(allocation.data, &data, sizeof(T));
+			return allocation.offset;
+		}
+
+		// Descriptor info for a dynamic uniform buffer binding reading blocks of blockSize bytes
+		vk::DescriptorBufferInfo getDescriptorInfo(vk::DeviceSize blockSize) { return { m_Buffer->getBuffer(), 0, blockSize }; }
+		vk::Buffer getBuffer() { return m_Buffer->getBuffer(); }
+		vk::DeviceSize getFrameSize() const { return m_FrameSize; }
+		vk::DeviceSize getAlignment() const { return m_Alignment; }
+
+	private:
+		SdeDevice& m_Device;
+		std::unique_ptr<SdeBuffer> m_Buffer;
+		uint8_t* m_MappedData = nullptr;
+
+		vk::DeviceSize m_FrameSize;
+		vk::DeviceSize m_Alignment;
+
+		vk::DeviceSize m_FrameBegin = 0;
+		std::atomic<vk::DeviceSize> m_Head{ 0 };
+	};
+
+}
@@ -0,0 +1,295 @@
+#include "sde_upload_manager.h"
+#include "sde_trace.h"
+#include "sde_timeline.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+namespace sde {
+
+	SdeUploadManager::SdeUploadManager(SdeDevice& device) : m_Device(device)
+	{
+		vk::CommandPoolCreateInfo poolInfo = {};
+		poolInfo.flags = vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
+		poolInfo.queueFamilyIndex = m_Device.findPhysicalQueueFamilies().graphicsFamily.value();
+
+		m_CommandPool = m_Device.device().createCommandPool(poolInfo);
+
+		// Buffer copies have no offset requirement, this keeps them fast. Image copies add their texel size in uploadImage.
+		auto limits = m_Device.getProperties().limits;
+		m_StagingAlignment = std::max<vk::DeviceSize>(4, limits.optimalBufferCopyOffsetAlignment);
+		m_StagingRing = std::make_unique<SdeStagingRing>(m_Device);
+	}
+
+	SdeUploadManager::~SdeUploadManager()
+	{
+		waitIdle();
+
+		m_Device.device().destroyCommandPool(m_CommandPool);
+	}
+
+	SdeUploadHandle SdeUploadManager::uploadBuffer(vk::Buffer dst, const void* data, vk::DeviceSize size, vk::DeviceSize dstOffset)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		// Staging first, making room may flush the batch being recorded
+		auto staging = stage(data, size, m_StagingAlignment);
+		auto& batch = currentBatch();
+
+		vk::BufferCopy copyRegion = {};
+		copyRegion.srcOffset = staging.offset;
+		copyRegion.dstOffset = dstOffset;
+		copyRegion.size = size;
+
+		batch.commandBuffer.copyBuffer(staging.buffer, dst, 1, &copyRegion);
+		return batch.id;
+	}
+
+	SdeUploadHandle SdeUploadManager::uploadImage(
+		vk::Image dst,
+		const void* data,
+		vk::DeviceSize size,
+		vk::Extent3D extent,
+		vk::DeviceSize texelBlockSize,
+		vk::ImageLayout finalLayout,
+		vk::ImageAspectFlags aspect)
+	{
+		if (texelBlockSize == 0) {
+			throw std::runtime_error("Image upload needs the texel block size");
+		}
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		// bufferOffset must be a multiple of the texel block size and of 4, e.g. 12 for R32G32B32
+		auto staging = stage(data, size, std::lcm(m_StagingAlignment, texelBlockSize));
+		auto& batch = currentBatch();
+
+		vk::ImageMemoryBarrier barrier = {};
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = dst;
+		barrier.subresourceRange = vk::ImageSubresourceRange(aspect, 0, 1, 0, 1);
+
+		// 1. Undefined -> transfer destination
+		barrier.oldLayout = vk::ImageLayout::eUndefined;
+		barrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
+		barrier.srcAccessMask = {};
+		barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+
+		batch.commandBuffer.pipelineBarrier(
+			vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer,
+			{}, nullptr, nullptr, barrier);
+
+		// 2. Copy
+		vk::BufferImageCopy region = {};
+		region.bufferOffset = staging.offset;
+		region.imageSubresource = vk::ImageSubresourceLayers(aspect, 0, 0, 1);
+		region.imageOffset = vk::Offset3D(0, 0, 0);
+		region.imageExtent = extent;
+
+		batch.commandBuffer.copyBufferToImage(staging.buffer, dst, vk::ImageLayout::eTransferDstOptimal, region);
+
+		// 3. Transfer destination -> final layout
+		barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+		barrier.newLayout = finalLayout;
+		barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+		barrier.dstAccessMask = vk::AccessFlagBits::eMemoryRead;
+
+		batch.commandBuffer.pipelineBarrier(
+			vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eAllCommands,
+			{}, nullptr, nullptr, barrier);
+
+		return batch.id;
+	}
+
+	SdeUploadHandle SdeUploadManager::copyBuffer(vk::Buffer src, vk::Buffer dst, vk::DeviceSize size, vk::DeviceSize srcOffset, vk::DeviceSize dstOffset)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		auto& batch = currentBatch();
+
+		vk::BufferCopy copyRegion = {};
+		copyRegion.srcOffset = srcOffset;
+		copyRegion.dstOffset = dstOffset;
+		copyRegion.size = size;
+
+		batch.commandBuffer.copyBuffer(src, dst, 1, &copyRegion);
+		return batch.id;
+	}
+
+	SdeUploadHandle SdeUploadManager::flush()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return flushLocked();
+	}
+
+	bool SdeUploadManager::isComplete(SdeUploadHandle handle)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		collectLocked();
+		return handle <= m_CompletedBatchId;
+	}
+
+	void SdeUploadManager::wait(SdeUploadHandle handle)
+	{
+		SDE_TRACE_FUNCTION();
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		// Still recording, submit it so there is something to wait on
+		if (m_CurrentBatch && handle >= m_CurrentBatch->id) {
+			flushLocked();
+		}
+
+		// Batches retire in order, waiting for the last one up to handle covers the others
+		uint64_t timelineValue = 0;
+		for (const auto& batch : m_InFlightBatches) {
+			if (batch.id > handle) break;
+			timelineValue = batch.timelineValue;
+		}
+		m_Device.timeline().wait(timelineValue);
+
+		collectLocked();
+	}
+
+	void SdeUploadManager::waitIdle()
+	{
+		SdeUploadHandle lastHandle;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			lastHandle = m_CurrentBatch ? m_CurrentBatch->id : m_NextBatchId - 1;
+		}
+		wait(lastHandle);
+	}
+
+	void SdeUploadManager::collect()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		collectLocked();
+	}
+
+	SdeUploadManager::Batch& SdeUploadManager::currentBatch()
+	{
+		if (m_CurrentBatch) return *m_CurrentBatch;
+
+		Batch batch;
+		batch.id = m_NextBatchId++;
+
+		if (!m_FreeCommandBuffers.empty()) {
+			batch.commandBuffer = m_FreeCommandBuffers.back();
+			m_FreeCommandBuffers.pop_back();
+		}
+		else {
+			vk::CommandBufferAllocateInfo allocateInfo = {};
+			allocateInfo.level = vk::CommandBufferLevel::ePrimary;
+			allocateInfo.commandPool = m_CommandPool;
+			allocateInfo.commandBufferCount = 1;
+
+			batch.commandBuffer = m_Device.device().allocateCommandBuffers(allocateInfo)[0];
+		}
+
+		batch.commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+
+		m_CurrentBatch = std::move(batch);
+		return *m_CurrentBatch;
+	}
+
+	SdeUploadManager::StagingRegion SdeUploadManager::stage(const void* data, vk::DeviceSize size, vk::DeviceSize alignment)
+	{
+		// Oversized requests would starve the ring, give them their own buffer
+		if (size > m_StagingRing->capacity() / 2) {
+			auto staging = std::make_unique<SdeBuffer>(m_Device, size,
+				vk::BufferUsageFlagBits::eTransferSrc,
+				vma::AllocationCreateFlagBits::eHostAccessSequentialWrite | vma::AllocationCreateFlagBits::eMapped);
+
+			staging->writeTo(const_cast<void*>(data));
+
+			StagingRegion region = { staging->getBuffer(), 0 };
+			currentBatch().dedicatedStaging.push_back(std::move(staging));
+			return region;
+		}
+
+		auto allocation = m_StagingRing->allocate(size, alignment, pendingBatchId());
+		while (!allocation) {
+			SDE_TRACE_ZONE("WaitForStaging");
+
+			if (!m_InFlightBatches.empty()) {
+				// Oldest batch owns the oldest ring regions
+				m_Device.timeline().wait(m_InFlightBatches.front().timelineValue);
+				collectLocked();
+			}
+			else if (m_CurrentBatch) {
+				// The batch being recorded filled the ring on its own
+				flushLocked();
+			}
+			else {
+				throw std::runtime_error("Staging ring cannot fit upload");
+			}
+
+			allocation = m_StagingRing->allocate(size, alignment, pendingBatchId());
+		}
+
+		std::memcpy(allocation->mappedData, data, size);
+		m_StagingRing->flush(*allocation);
+
+		return { allocation->buffer, allocation->offset };
+	}
+
+	SdeUploadHandle SdeUploadManager::flushLocked()
+	{
+		if (!m_CurrentBatch) return m_NextBatchId - 1;
+
+		SDE_TRACE_ZONE("SdeUploadManager::flush");
+
+		auto batch = std::move(*m_CurrentBatch);
+		m_CurrentBatch.reset();
+
+		// Make every copy of the batch visible to whatever is submitted after it on this queue
+		vk::MemoryBarrier barrier = {};
+		barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+		barrier.dstAccessMask = vk::AccessFlagBits::eMemoryRead;
+
+		batch.commandBuffer.pipelineBarrier(
+			vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eAllCommands,
+			{}, barrier, nullptr, nullptr);
+
+		batch.commandBuffer.end();
+
+		vk::SubmitInfo submitInfo = {};
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &batch.commandBuffer;
+
+		batch.timelineValue = m_Device.timeline().submit(submitInfo);
+
+		SdeUploadHandle id = batch.id;
+		m_InFlightBatches.push_back(std::move(batch));
+		return id;
+	}
+
+	void SdeUploadManager::collectLocked()
+	{
+		// Batches share one queue, so they retire in submission order
+		while (!m_InFlightBatches.empty()) {
+			auto& batch = m_InFlightBatches.front();
+			if (!m_Device.timeline().isComplete(batch.timelineValue)) break;
+
+			m_CompletedBatchId = batch.id;
+			retire(batch);
+			m_InFlightBatches.pop_front();
+		}
+
+		m_StagingRing->retire(m_CompletedBatchId);
+	}
+
+	void SdeUploadManager::retire(Batch& batch)
+	{
+		batch.dedicatedStaging.clear();
+
+		batch.commandBuffer.reset();
+
+		m_FreeCommandBuffers.push_back(batch.commandBuffer);
+	}
+
+}
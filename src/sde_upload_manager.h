@@ -0,0 +1,87 @@
+#pragma once
+
+#include "sde_device.h"
+#include "sde_buffer.h"
+#include "sde_staging_ring.h"
+
+#include <vulkan/vulkan.hpp>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace sde {
+
+	// Identifies the batch an upload was recorded into, complete once that batch retired
+	using SdeUploadHandle = uint64_t;
+
+	class SdeUploadManager {
+	public:
+		SdeUploadManager(SdeDevice& device);
+		~SdeUploadManager();
+
+		SdeUploadManager(const SdeUploadManager&) = delete;
+		SdeUploadManager& operator=(const SdeUploadManager&) = delete;
+
+		// Recording: data is copied to staging memory right away, the GPU copy is batched until flush()
+		SdeUploadHandle uploadBuffer(vk::Buffer dst, const void* data, vk::DeviceSize size, vk::DeviceSize dstOffset = 0);
+		SdeUploadHandle uploadImage(
+			vk::Image dst,
+			const void* data,
+			vk::DeviceSize size,
+			vk::Extent3D extent,
+			vk::DeviceSize texelBlockSize, // Bytes per texel, or per block of a compressed format
+			vk::ImageLayout finalLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+			vk::ImageAspectFlags aspect = vk::ImageAspectFlagBits::eColor
+		);
+		SdeUploadHandle copyBuffer(vk::Buffer src, vk::Buffer dst, vk::DeviceSize size, vk::DeviceSize srcOffset = 0, vk::DeviceSize dstOffset = 0);
+
+		// Submits the recorded batch to the graphics queue. Must run on the thread that owns queue submission.
+		// Returns the handle of the submitted batch, or of the last one if nothing was recorded.
+		SdeUploadHandle flush();
+
+		// Non-blocking, also releases staging memory of every retired batch
+		bool isComplete(SdeUploadHandle handle);
+		void wait(SdeUploadHandle handle);
+		void waitIdle();
+		void collect();
+
+	private:
+		struct Batch {
+			SdeUploadHandle id = 0;
+			vk::CommandBuffer commandBuffer;
+			uint64_t timelineValue = 0; // Set on submit
+			std::vector<std::unique_ptr<SdeBuffer>> dedicatedStaging; // Requests too big for the ring
+		};
+
+		struct StagingRegion {
+			vk::Buffer buffer;
+			vk::DeviceSize offset;
+		};
+
+		Batch& currentBatch();
+		SdeUploadHandle pendingBatchId() const { return m_CurrentBatch ? m_CurrentBatch->id : m_NextBatchId; }
+		StagingRegion stage(const void* data, vk::DeviceSize size, vk::DeviceSize alignment);
+		SdeUploadHandle flushLocked();
+		void collectLocked();
+		void retire(Batch& batch);
+
+	private:
+		SdeDevice& m_Device;
+		std::mutex m_Mutex;
+
+		std::unique_ptr<SdeStagingRing> m_StagingRing;
+		vk::DeviceSize m_StagingAlignment = 4;
+
+		vk::CommandPool m_CommandPool;
+		std::vector<vk::CommandBuffer> m_FreeCommandBuffers;
+
+		std::optional<Batch> m_CurrentBatch;
+		std::deque<Batch> m_InFlightBatches;
+
+		SdeUploadHandle m_NextBatchId = 1;
+		SdeUploadHandle m_CompletedBatchId = 0;
+	};
+
+}
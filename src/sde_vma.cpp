@@ -0,0 +1,4 @@
+#define VMA_IMPLEMENTATION
+#define VMA_STATIC_VULKAN_FUNCTIONS 0
+#define VMA_DYNAMIC_VULKAN_FUNCTION 1
+#include "vk_mem_alloc.hpp"